@@ -10,6 +10,8 @@
 using addr_t = uint64_t;
 using counter = uint64_t;
 
+const counter MAX_CYCLE = UINT64_MAX;   ///< no pending event (see get_next_event_cycle())
+
 #ifdef __DEBUG__
 #define DEBUG(args...)          \
   do {                          \
@@ -7,6 +7,9 @@
 #include <cstdint>
 #include "global.h"
 
+// forward declaration
+class cache_c;
+
 enum MEMORY_TYPE {
   MEM_L1 = 1,
   MEM_L2,
@@ -19,6 +22,7 @@ enum MEM_REQ_TYPE {
   REQ_DSTORE,          ///< data write
   REQ_IFETCH,          ///< instruction fetch (read)
   REQ_WB,              ///< Write-back
+  REQ_PREFETCH,        ///< hardware prefetch (read); fills without counting as an access
   REQ_LAST
 };
 
@@ -35,11 +39,17 @@ struct mem_req_s {
                          
   bool     m_done;       ///< request done? (data returned?)
   bool     m_dirty;      
+
+  uint32_t m_in_flight_idx;  ///< slot in memory_hierarchy_c::m_in_flight_reqs (core requests only)
+  cache_c* m_pf_source;      ///< REQ_PREFETCH: the cache that issued it (and is filled by it)
+  int      m_core_id;        ///< core the request belongs to (0 with a single core)
   
   mem_req_s(addr_t addr, int access_type) {
     m_addr = addr;
     m_type = access_type;
     m_size = 0;
+    m_pf_source = nullptr;
+    m_core_id = 0;
   };
 };
 
@@ -0,0 +1,98 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __MEM_REQ_POOL_H__
+#define __MEM_REQ_POOL_H__
+
+#include "mem_req.h"
+
+#include <cstdio>
+#include <new>
+#include <unordered_set>
+#include <vector>
+
+/***
+ *
+ * @class memory request pool (mem_req_pool_c)
+ *
+ * Every memory request in the hierarchy (core requests and write-backs) is
+ * allocated from this pool and returned to it once it is done, so the
+ * simulation recycles a working set of requests instead of going to the heap
+ * for each one.  Storage is carved out of slabs of SLAB_SIZE requests and
+ * free requests are kept on a LIFO free list, so a freed request is the next
+ * one handed out while it is still in the cache.
+ */
+
+class mem_req_pool_c {
+public:
+  static const int SLAB_SIZE = 1024;   ///< requests per slab
+
+  mem_req_pool_c() : m_num_live(0), m_num_allocs(0) {}
+  ~mem_req_pool_c() {
+    for (mem_req_s* slab : m_slabs)
+      ::operator delete(slab);
+  }
+
+  /// take a request from the pool; fields are set up as by the constructor
+  mem_req_s* alloc(addr_t addr, int access_type) {
+    if (m_free.empty()) grow();
+
+    mem_req_s* req = m_free.back();
+    m_free.pop_back();
+    ++m_num_live;
+    ++m_num_allocs;
+    return new (req) mem_req_s(addr, access_type);
+  }
+
+  /// return a request to the pool
+  void free(mem_req_s* req) {
+    --m_num_live;
+    m_free.push_back(req);
+  }
+
+  counter get_num_live() const { return m_num_live; }
+  counter get_num_allocs() const { return m_num_allocs; }
+  size_t  get_capacity() const { return m_slabs.size() * SLAB_SIZE; }
+
+  /**
+   * Report the requests that were never returned (call at the end of
+   * simulation when nothing should be in flight).  Returns the leak count.
+   */
+  counter report_leaks(int max_print = 8) const {
+    if (m_num_live == 0) return 0;
+
+    fprintf(stderr, "[Warning]: %lu memory request(s) never returned to the pool\n",
+            (unsigned long)m_num_live);
+
+    std::unordered_set<const mem_req_s*> free_set(m_free.begin(), m_free.end());
+    int num_printed = 0;
+    for (mem_req_s* slab : m_slabs) {
+      for (int ii = 0; ii < SLAB_SIZE && num_printed < max_print; ++ii) {
+        const mem_req_s* req = slab + ii;
+        if (free_set.count(req)) continue;
+        fprintf(stderr, "  REQ #%u type %d addr %#lx rdy %lu\n",
+                req->m_id, req->m_type, (unsigned long)req->m_addr,
+                (unsigned long)req->m_rdy_cycle);
+        ++num_printed;
+      }
+    }
+    return m_num_live;
+  }
+
+private:
+  void grow() {
+    mem_req_s* slab = static_cast<mem_req_s*>(::operator new(sizeof(mem_req_s) * SLAB_SIZE));
+    m_slabs.push_back(slab);
+
+    // push in reverse so requests are handed out in address order
+    for (int ii = SLAB_SIZE - 1; ii >= 0; --ii)
+      m_free.push_back(slab + ii);
+  }
+
+  std::vector<mem_req_s*> m_slabs;  ///< slab storage (raw, SLAB_SIZE requests each)
+  std::vector<mem_req_s*> m_free;   ///< free list
+  counter m_num_live;               ///< requests handed out and not yet returned
+  counter m_num_allocs;             ///< total allocations
+};
+
+#endif // !__MEM_REQ_POOL_H__
@@ -0,0 +1,83 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __READY_QUEUE_H__
+#define __READY_QUEUE_H__
+
+#include "mem_req.h"
+
+#include <algorithm>
+#include <vector>
+
+/***
+ *
+ * @class ready-time-ordered memory queue (ready_queue_c)
+ *
+ * A memory queue that hands out requests in order of their ready cycle, and
+ * in arrival order among requests that become ready in the same cycle.  It is
+ * a binary min-heap keyed on (m_rdy_cycle at push time, arrival sequence), so
+ * a component only touches the requests that are ready this cycle instead of
+ * scanning the whole queue, and the earliest ready cycle is known in O(1).
+ *
+ * Requests must not change their m_rdy_cycle while they sit in the queue.
+ * Like queue_c, m_size of zero means no back pressure.
+ */
+
+class ready_queue_c {
+public:
+  ready_queue_c() : m_size(0), m_seq(0) {}
+  ready_queue_c(int size) : m_size(size), m_seq(0) {}
+
+  /// push a new request into queue
+  bool push(mem_req_s* req) {
+    if (full()) return false;
+
+    m_heap.push_back({req->m_rdy_cycle, m_seq++, req});
+    std::push_heap(m_heap.begin(), m_heap.end(), later);
+    return true;
+  }
+
+  /// the oldest request that is ready by "cycle" (nullptr if none)
+  mem_req_s* peek_ready(counter cycle) const {
+    if (m_heap.empty() || m_heap.front().m_rdy_cycle > cycle) return nullptr;
+    return m_heap.front().m_req;
+  }
+
+  /// remove the request returned by peek_ready()
+  void pop() {
+    std::pop_heap(m_heap.begin(), m_heap.end(), later);
+    m_heap.pop_back();
+  }
+
+  /// earliest ready cycle in the queue (MAX_CYCLE if empty)
+  counter get_earliest_rdy_cycle() const {
+    return m_heap.empty() ? MAX_CYCLE : m_heap.front().m_rdy_cycle;
+  }
+
+  /// returns true if the queue is full
+  bool full() const { return m_size && (m_heap.size() == m_size); }
+
+  /// returns true if the queue is empty
+  bool empty() const { return m_heap.empty(); }
+
+  size_t size() const { return m_heap.size(); }
+
+private:
+  struct entry_s {
+    counter    m_rdy_cycle;   ///< ready cycle of the request when it was pushed
+    counter    m_seq;         ///< arrival order (FIFO among equal ready cycles)
+    mem_req_s* m_req;
+  };
+
+  /// heap order: true if "a" comes out after "b"
+  static bool later(const entry_s& a, const entry_s& b) {
+    if (a.m_rdy_cycle != b.m_rdy_cycle) return a.m_rdy_cycle > b.m_rdy_cycle;
+    return a.m_seq > b.m_seq;
+  }
+
+  std::vector<entry_s> m_heap;   ///< queue entries (binary min-heap)
+  unsigned int m_size;           ///< queue size: no size limit if zero
+  counter m_seq;                 ///< next arrival sequence number
+};
+
+#endif // !__READY_QUEUE_H__
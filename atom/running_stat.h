@@ -0,0 +1,60 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __RUNNING_STAT_H__
+#define __RUNNING_STAT_H__
+
+#include <cmath>
+#include <cstdint>
+
+/***
+ *
+ * @class running mean/variance (running_stat_c)
+ *
+ * Accumulates samples one at a time (Welford's method) and gives their mean
+ * and the half-width of a 95% confidence interval for it, as used for
+ * sampled simulation estimates.  The interval uses Student's t with
+ * count - 1 degrees of freedom, since a run may measure only a few units.
+ */
+
+class running_stat_c {
+public:
+  running_stat_c() : m_count(0), m_mean(0.0), m_m2(0.0) {}
+
+  void add(double x) {
+    ++m_count;
+    double delta = x - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (x - m_mean);
+  }
+
+  uint64_t count() const { return m_count; }
+  double   mean() const { return m_mean; }
+
+  /// sample standard deviation (0 with fewer than two samples)
+  double stddev() const { return (m_count > 1) ? std::sqrt(m_m2 / (m_count - 1)) : 0.0; }
+
+  /// half-width of the 95% confidence interval of the mean (0 with fewer than two samples)
+  double confidence() const {
+    return (m_count > 1) ? t_quantile(m_count - 1) * stddev() / std::sqrt((double)m_count) : 0.0;
+  }
+
+  /// two-sided 95% quantile of Student's t with "df" (>= 1) degrees of freedom
+  static double t_quantile(uint64_t df) {
+    static const double table[30] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+       2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+       2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (df <= 30) return table[df - 1];
+    // normal quantile (1.96) with the first-order correction for df
+    const double z = 1.96;
+    return z + (z * z * z + z) / (4.0 * df);
+  }
+
+private:
+  uint64_t m_count;
+  double   m_mean;
+  double   m_m2;      ///< sum of squared deviations from the mean
+};
+
+#endif // !__RUNNING_STAT_H__
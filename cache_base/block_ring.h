@@ -0,0 +1,117 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __BLOCK_RING_H__
+#define __BLOCK_RING_H__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * @class block_ring_c
+ *
+ * Lock-free ring of "depth" blocks (any block type T) handed from one
+ * producer thread to its consumers.  Blocks are numbered in the order they
+ * are published; block "seq" lives in slot seq % depth.
+ *
+ * The producer fills get(get_tail()) while is_full() is false, then
+ * publish()es it, and calls finish() after the last block.  A consumer walks
+ * seq = 0, 1, ... while wait(seq) returns true, reads get(seq) and then
+ * release()s it.
+ *
+ * With one consumer the slot frees up once the consumer's head moves past
+ * it.  With several consumers every block is broadcast to all of them: each
+ * slot keeps the number of consumers still reading it, and is free once the
+ * count drops to zero.
+ *
+ * The thread that owns the ring calls init() or reset() only while no
+ * producer or consumer is running.
+ */
+template <typename T>
+class block_ring_c {
+public:
+  block_ring_c() : m_depth(0), m_num_consumers(1), m_tail(0), m_done(false), m_head(0) {}
+
+  /// "num_consumers" above 1: every block goes to all of them
+  void init(int depth, int num_consumers = 1) {
+    m_depth = depth;
+    m_num_consumers = num_consumers;
+    m_slots.resize(depth);
+    m_pending.reset(num_consumers > 1 ? new std::atomic<int>[depth] : nullptr);
+    reset();
+  }
+
+  /// empties the ring for another run
+  void reset() {
+    if (m_pending) {
+      for (int ii = 0; ii < m_depth; ++ii) m_pending[ii].store(0, std::memory_order_relaxed);
+    }
+    m_head.store(0, std::memory_order_relaxed);
+    m_tail.store(0, std::memory_order_relaxed);
+    m_done.store(false, std::memory_order_relaxed);
+  }
+
+  int get_depth() const { return m_depth; }
+  T&  get(uint64_t seq) { return m_slots[seq % m_depth]; }
+
+  // ---- producer ---- //
+
+  /// next block to publish
+  uint64_t get_tail() const { return m_tail.load(std::memory_order_relaxed); }
+
+  /// the slot of the next block is still being read
+  bool is_full() const {
+    const uint64_t tail = get_tail();
+    if (m_pending) return m_pending[tail % m_depth].load(std::memory_order_acquire) != 0;
+    return tail - m_head.load(std::memory_order_acquire) == (uint64_t)m_depth;
+  }
+
+  /// hands get(get_tail()) to the consumers
+  void publish() {
+    const uint64_t tail = get_tail();
+    if (m_pending) m_pending[tail % m_depth].store(m_num_consumers, std::memory_order_relaxed);
+    m_tail.store(tail + 1, std::memory_order_release);
+  }
+
+  /// no more blocks will be published
+  void finish() { m_done.store(true, std::memory_order_release); }
+
+  // ---- consumers ---- //
+
+  bool is_published(uint64_t seq) const { return seq < m_tail.load(std::memory_order_acquire); }
+
+  /// waits until block "seq" is published; false once the producer finished without it
+  bool wait(uint64_t seq) const {
+    while (!is_published(seq)) {
+      // check m_tail again after seeing m_done; the last block may have just landed
+      if (m_done.load(std::memory_order_acquire) && !is_published(seq)) return false;
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  /// this consumer is done with block "seq"
+  void release(uint64_t seq) {
+    if (m_pending) m_pending[seq % m_depth].fetch_sub(1, std::memory_order_release);
+    else           m_head.store(seq + 1, std::memory_order_release);
+  }
+
+private:
+  block_ring_c(const block_ring_c&);              // not copyable
+  block_ring_c& operator=(const block_ring_c&);
+
+  int m_depth;
+  int m_num_consumers;
+  std::vector<T> m_slots;
+  std::unique_ptr<std::atomic<int>[]> m_pending;  ///< broadcast: consumers still reading each slot
+
+  std::atomic<uint64_t> m_tail;                   ///< blocks published (producer)
+  std::atomic<bool>     m_done;                   ///< the producer has finished
+  char                  m_pad[64];                ///< keep the consumer index off the producer's line
+  std::atomic<uint64_t> m_head;                   ///< single consumer: blocks released
+};
+
+#endif // !__BLOCK_RING_H__
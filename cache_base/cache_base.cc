@@ -9,8 +9,13 @@
  */
 
 #include "cache_base.h"
+#include "checkpoint_format.h"
+#include "replacement.h"
+#include "tag_match.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <string>
 #include <cassert>
 #include <fstream>
@@ -18,52 +23,163 @@
 #include <iomanip>
 
 /**
- * This allocates an "assoc" number of cache entries per a set
- * @param assoc - number of cache entries in a set
+ * Geometry policies for the tag store kernels.
+ *
+ * Each accessor takes the run-time value and either returns it as is
+ * (generic_geometry_s) or ignores it and returns a compile-time constant
+ * (fixed_geometry_s), so the same kernel source serves both and the fixed
+ * instantiations fold the shifts, masks and way loops into constants.
  */
-cache_set_c::cache_set_c(int assoc) {
-  m_entry = new cache_entry_c[assoc];
-  m_assoc = assoc;
+constexpr int log2_of(int value) {
+  return (value <= 1) ? 0 : 1 + log2_of(value >> 1);
+}
 
-  for (int i = 0; i < m_assoc; ++i) {
-    m_entry[i].m_valid = false;
-    m_entry[i].m_dirty = false;
-    m_entry[i].m_tag   = 0;
-    m_lru_list.push_back(i);  // initially MRU->LRU same order
-  }
+struct generic_geometry_s {
+  static int    assoc(int assoc)             { return assoc; }
+  static int    line_shift(int line_shift)   { return line_shift; }
+  static int    set_shift(int set_shift)     { return set_shift; }
+  static addr_t set_mask(addr_t set_mask)    { return set_mask; }
+};
+
+template <int LINE_SIZE, int NUM_SETS, int ASSOC>
+struct fixed_geometry_s {
+  static_assert((LINE_SIZE & (LINE_SIZE - 1)) == 0, "line size must be a power of two");
+  static_assert((NUM_SETS & (NUM_SETS - 1)) == 0, "number of sets must be a power of two");
+
+  static int    assoc(int)                   { return ASSOC; }
+  static int    line_shift(int)              { return log2_of(LINE_SIZE); }
+  static int    set_shift(int)               { return log2_of(NUM_SETS); }
+  static addr_t set_mask(addr_t)             { return NUM_SETS - 1; }
+};
+
+/**
+ * Geometries that get their own compile-time kernel: the caches in
+ * configs/i7.cfg and configs/memory.cfg, plus the Part I experiments
+ * (16KB direct-mapped/2/4/8-way and the 8KB 2-way example), all with 64B
+ * lines.  Any other power-of-two geometry runs on the generic kernel.
+ *
+ *   X(line size, number of sets, associativity)
+ */
+#define SPECIALIZED_GEOMETRIES(X) \
+  X(64,   16, 2)                  \
+  X(64,   64, 2)                  \
+  X(64,  128, 2)                  \
+  X(64,  256, 1)                  \
+  X(64,   64, 4)                  \
+  X(64, 1024, 4)                  \
+  X(64,   32, 8)                  \
+  X(64,   64, 8)
+
+static bool is_power_of_two(int value) {
+  return value > 0 && (value & (value - 1)) == 0;
 }
 
-// cache_set_c destructor
-cache_set_c::~cache_set_c() {
-  delete[] m_entry;
+/**
+ * Replacement policies by config name, in repl_policy_e order.
+ *
+ *   X(enum, name, policy struct)
+ */
+#define REPLACEMENT_POLICIES(X)                     \
+  X(REPL_LRU,       "lru",       lru_policy_s)       \
+  X(REPL_TREE_PLRU, "tree_plru", tree_plru_policy_s) \
+  X(REPL_BIT_PLRU,  "bit_plru",  bit_plru_policy_s)  \
+  X(REPL_SRRIP,     "srrip",     srrip_policy_s)     \
+  X(REPL_DRRIP,     "drrip",     drrip_policy_s)     \
+  X(REPL_RANDOM,    "random",    random_policy_s)    \
+  X(REPL_OPT,       "opt",       opt_policy_s)
+
+int parse_repl_policy(const std::string& name) {
+#define PARSE_POLICY(policy, str, type) if (name == str) return policy;
+  REPLACEMENT_POLICIES(PARSE_POLICY)
+#undef PARSE_POLICY
+  return -1;
+}
+
+const char* repl_policy_name(int policy) {
+#define POLICY_NAME(id, str, type) if (policy == id) return str;
+  REPLACEMENT_POLICIES(POLICY_NAME)
+#undef POLICY_NAME
+  return "unknown";
 }
 
+const uint64_t cache_base_c::NO_NEXT_USE;
+const uint64_t cache_base_c::ALL_WAYS;
+
 /**
  * This constructor initializes a cache structure based on the cache parameters.
  * @param name - cache name; use any name you want
  * @param num_sets - number of sets in a cache
  * @param assoc - number of cache entries in a set
  * @param line_size - cache block (line) size in bytes
+ * @param repl_policy - replacement policy (repl_policy_e, true LRU by default)
+ * @param repl_seed - seed for the policies that make random choices
+ * @param sparse - allocate the sets on first touch instead of up front
+ *
+ * The tag store and the replacement state are two flat arrays indexed by
+ * (set * assoc + way); every set starts out invalid (with way 0 at MRU for
+ * LRU).  The number of sets and the line size must be powers of two, so the
+ * set index and tag are extracted with shifts and masks.
  *
- * @note You do not have to modify this (other than for debugging purposes).
+ * The arrays live in pages of consecutive sets behind a directory.  A dense
+ * cache has a single page holding every set.  A sparse cache has pages of
+ * SPARSE_PAGE_SETS sets, allocated (all invalid) the first time one of their
+ * sets is accessed, so a huge cache costs memory and startup time only for
+ * the sets a trace touches; a set that was never touched behaves exactly
+ * like an invalid one.
  */
-cache_base_c::cache_base_c(std::string name, int num_sets, int assoc, int line_size) {
+cache_base_c::cache_base_c(std::string name, int num_sets, int assoc, int line_size,
+                           int repl_policy, uint64_t repl_seed, bool sparse) {
   m_name = name;
   m_num_sets = num_sets;
+  m_assoc = assoc;
   m_line_size = line_size;
 
-  m_set = new cache_set_c *[m_num_sets];
-
-  for (int ii = 0; ii < m_num_sets; ++ii) {
-    m_set[ii] = new cache_set_c(assoc);
-
-    // initialize tag/valid/dirty bits
-    for (int jj = 0; jj < assoc; ++jj) {
-      m_set[ii]->m_entry[jj].m_valid = false;
-      m_set[ii]->m_entry[jj].m_dirty = false;
-      m_set[ii]->m_entry[jj].m_tag   = 0;
-    }
+  assert(is_power_of_two(num_sets) && "number of sets must be a power of two");
+  assert(is_power_of_two(line_size) && "line size must be a power of two");
+  assert(assoc > 0 && assoc <= UINT16_MAX && "unsupported associativity");
+  assert(repl_policy >= 0 && repl_policy < REPL_LAST && "unknown replacement policy");
+  assert((repl_policy != REPL_TREE_PLRU || is_power_of_two(assoc)) &&
+         "tree PLRU needs a power-of-two associativity");
+
+  m_line_shift = log2_of(line_size);
+  m_set_shift  = log2_of(num_sets);
+  m_set_mask   = (addr_t)num_sets - 1;
+
+  m_repl_policy = repl_policy;
+  m_psel = drrip_policy_s::PSEL_MAX / 2;
+  m_rng  = repl_seed ? repl_seed : 1;   // xorshift state must be non-zero
+
+  m_next_use = NO_NEXT_USE;
+
+  m_num_sources = 0;
+  m_source   = 0;
+  m_way_mask = ALL_WAYS;
+
+  m_sparse     = sparse;
+  m_page_shift = (sparse && num_sets > SPARSE_PAGE_SETS) ? log2_of(SPARSE_PAGE_SETS) : m_set_shift;
+  m_page_mask  = (1 << m_page_shift) - 1;
+  m_page_ways  = (size_t)assoc << m_page_shift;
+  m_next_use_offset = (repl_policy == REPL_OPT) ? m_page_ways : 0;
+  m_state_offset    = m_page_ways + (m_next_use_offset ? m_page_ways : 0);
+  m_page_words = m_state_offset + (m_page_ways * sizeof(uint16_t) + 7) / 8;
+  m_num_pages  = num_sets >> m_page_shift;
+  m_num_allocated_pages = 0;
+  m_pages = new uint64_t*[m_num_pages]();
+
+  // bind the lookup kernels once; specialized geometries skip the run-time values
+  m_specialized = false;
+  bind_policy<generic_geometry_s>();
+#ifndef __NO_GEOMETRY_SPECIALIZATION__
+#define BIND_SPECIALIZED(line, sets, ways)                                \
+  if (m_line_size == line && m_num_sets == sets && m_assoc == ways) {     \
+    bind_policy<fixed_geometry_s<line, sets, ways>>();                     \
+    m_specialized = true;                                                  \
   }
+  SPECIALIZED_GEOMETRIES(BIND_SPECIALIZED)
+#undef BIND_SPECIALIZED
+#endif
+
+  if (!m_sparse) alloc_page(0);
 
   // initialize stats
   m_num_accesses = 0;
@@ -71,12 +187,129 @@ cache_base_c::cache_base_c(std::string name, int num_sets, int assoc, int line_s
   m_num_misses = 0;
   m_num_writes = 0;
   m_num_writebacks = 0;
+  m_num_unsampled = 0;
+
+  m_set_sample_ratio = 1;
 }
 
 // cache_base_c destructor
 cache_base_c::~cache_base_c() {
-  for (int ii = 0; ii < m_num_sets; ++ii) { delete m_set[ii]; }
-  delete[] m_set;
+  for (size_t ii = 0; ii < m_num_pages; ++ii) delete[] m_pages[ii];
+  delete[] m_pages;
+}
+
+/**
+ * Binds the kernels for geometry G and replacement policy P.
+ */
+template <class G, class P>
+void cache_base_c::bind_kernels() {
+  m_access_fn            = &cache_base_c::access_impl<G, P>;
+  m_invalidate_fn        = &cache_base_c::invalidate_impl<G, P>;
+  m_install_writeback_fn = &cache_base_c::install_writeback_impl<G, P>;
+  m_init_set_fn          = &P::init_set;
+}
+
+template <class G>
+void cache_base_c::bind_policy() {
+  switch (m_repl_policy) {
+#define BIND_POLICY(policy, str, type) case policy: bind_kernels<G, type>(); break;
+    REPLACEMENT_POLICIES(BIND_POLICY)
+#undef BIND_POLICY
+  }
+}
+
+/**
+ * Reset every set of a page to the policy's all-invalid state.
+ */
+void cache_base_c::init_page(uint64_t* page, size_t page_num) const {
+  memset(page, 0, m_page_words * sizeof(uint64_t));
+  if (m_next_use_offset)
+    std::fill(page + m_next_use_offset, page + m_next_use_offset + m_page_ways, NO_NEXT_USE);
+
+  uint16_t* state = reinterpret_cast<uint16_t*>(page + m_state_offset);
+  for (int ii = 0; ii <= m_page_mask; ++ii) {
+    repl_set_s view = repl_set_s();
+    view.state    = state + (size_t)ii * m_assoc;
+    view.words    = page + (size_t)ii * m_assoc;
+    view.assoc    = m_assoc;
+    view.set      = (int)(page_num << m_page_shift) + ii;
+    view.num_sets = m_num_sets;
+    view.way_mask = ALL_WAYS;
+    m_init_set_fn(view);
+  }
+}
+
+uint64_t* cache_base_c::alloc_page(size_t page_num) {
+  uint64_t* page = new uint64_t[m_page_words];
+  init_page(page, page_num);
+  m_pages[page_num] = page;
+  m_num_allocated_pages++;
+  return page;
+}
+
+template <class G>
+uint64_t* cache_base_c::set_words(int set) {
+  return page_of(set) + (size_t)(set & m_page_mask) * G::assoc(m_assoc);
+}
+
+/**
+ * Returns the way among the tag words of a set that holds a valid line with
+ * "tag", or -1.  The ways are compared in parallel by the tag_match kernel,
+ * up to 64 at a time.
+ */
+template <class G>
+int cache_base_c::find_way(const uint64_t* words, addr_t tag) const {
+  const int       assoc = G::assoc(m_assoc);
+  const uint64_t  key   = tag_word::key(tag);
+  for (int base = 0; base < assoc; base += 64) {
+    int n = (assoc - base < 64) ? assoc - base : 64;
+    uint64_t hits = tag_match(words + base, n, key, tag_word::KEY_MASK);
+    if (hits) return base + __builtin_ctzll(hits);
+  }
+  return -1;
+}
+
+/**
+ * The replacement policy's view of "set".
+ */
+template <class G>
+repl_set_s cache_base_c::repl_set(int set) {
+  const int    assoc  = G::assoc(m_assoc);
+  uint64_t*    page   = page_of(set);
+  const size_t offset = (size_t)(set & m_page_mask) * assoc;
+  repl_set_s view;
+  view.state    = reinterpret_cast<uint16_t*>(page + m_state_offset) + offset;
+  view.words    = page + offset;
+  view.next_use = m_next_use_offset ? page + m_next_use_offset + offset : nullptr;
+  view.assoc    = assoc;
+  view.set      = set;
+  view.num_sets = m_num_sets;
+  view.psel     = &m_psel;
+  view.rng      = &m_rng;
+  view.cur_next_use = m_next_use;
+  view.way_mask = m_way_mask;
+  return view;
+}
+
+/**
+ * Reports the line currently held in "way" as the victim (address 0 if the
+ * way is invalid) and counts a writeback if it is dirty.
+ */
+template <class G>
+void cache_base_c::evict(int set, int way, addr_t *evict_addr, bool *evict_dirty) {
+  const uint64_t word = set_words<G>(set)[way];
+  addr_t ev_line = 0;
+  bool   ev_dirty_flag = false;
+  if (tag_word::valid(word)) {
+    ev_line = ((tag_word::tag(word) << G::set_shift(m_set_shift)) | (addr_t)set)
+              << G::line_shift(m_line_shift);
+    if (tag_word::dirty(word)) {
+      m_num_writebacks++;
+      ev_dirty_flag = true;
+    }
+  }
+  if (evict_addr)  *evict_addr  = ev_line;
+  if (evict_dirty) *evict_dirty = ev_dirty_flag;
 }
 
 /** 
@@ -88,75 +321,149 @@ cache_base_c::~cache_base_c() {
  * @param is_fill - if the access is for a cache fill
  * @param return "true" on a hit; "false" otherwise.
  */
-bool cache_base_c::access(addr_t address, int access_type, bool is_fill, addr_t *evict_addr, bool *evict_dirty) {
-  ////////////////////////////////////////////////////////////////////
-  // TODO: Write the code to implement this function
-  
-    bool is_write = (access_type == WRITE);
-    // if (is_write) m_num_writes++;
-
-    if (!is_fill)
-    {
-        m_num_accesses++;
-        if (is_write) m_num_writes++;
-    }
+template <class G, class P>
+bool cache_base_c::access_impl(addr_t address, int access_type, bool is_fill, addr_t *evict_addr, bool *evict_dirty) {
+  bool is_write = (access_type == WRITE);
 
-    // compute set index and tag
-    addr_t line_num = address / m_line_size;
-    int    idx      = line_num % m_num_sets;
-    addr_t tag      = line_num / m_num_sets;
-
-    auto *set = m_set[idx];
-
-    // lookup
-    for (int way = 0; way < set->m_assoc; ++way) {
-        auto &ent = set->m_entry[way];
-        if (ent.m_valid && ent.m_tag == tag) {
-            if (!is_fill) m_num_hits++;
-            if (is_write) ent.m_dirty = true;
-            set->m_lru_list.remove(way);
-            set->m_lru_list.push_front(way);
-            if (evict_addr) *evict_addr = 0;
-            return true;
-        }
-    }
+  if (!is_fill) {
+    m_num_accesses++;
+    if (is_write) m_num_writes++;
+  }
 
-    // miss: find victim
-    if (!is_fill) m_num_misses++;
-    int victim = -1;
-    for (int way : set->m_lru_list) {
-        if (!set->m_entry[way].m_valid) { victim = way; break; }
-    }
-    if (victim < 0) {
-        victim = set->m_lru_list.back();
-        set->m_lru_list.pop_back();
-    } else {
-        set->m_lru_list.remove(victim);
-    }
+  // compute set index and tag
+  addr_t line_num = address >> G::line_shift(m_line_shift);
+  int    idx      = line_num & G::set_mask(m_set_mask);
+  addr_t tag      = line_num >> G::set_shift(m_set_shift);
+
+  repl_set_s repl  = repl_set<G>(idx);
+  uint64_t*  words = set_words<G>(idx);
+
+  // lookup
+  int way = find_way<G>(words, tag);
+  if (way >= 0) {
+    if (!is_fill) m_num_hits++;
+    if (is_write) words[way] |= tag_word::DIRTY;
+    P::on_hit(repl, way);
+    if (evict_addr) *evict_addr = 0;
+    return true;
+  }
 
-    // handle eviction
-    addr_t ev_line = 0;
-    bool   ev_dirty_flag = false;
-    auto  &ve = set->m_entry[victim];
-    if (ve.m_valid) {
-        ev_line = (ve.m_tag * m_num_sets + idx) * (addr_t)m_line_size;
-        if (ve.m_dirty) {
-            m_num_writebacks++;
-            ev_dirty_flag = true;
-        }
-    }
-    if (evict_addr)  *evict_addr  = ev_line;
-    if (evict_dirty) *evict_dirty = ev_dirty_flag;
+  // miss: evict the victim and install the new line (at MRU for LRU)
+  if (!is_fill) m_num_misses++;
+  int victim = P::victim(repl);
+  evict<G>(idx, victim, evict_addr, evict_dirty);
+  words[victim] = tag_word::make(tag, is_write);
+  P::on_insert(repl, victim, !is_fill);
+
+  return false;
+}
+
+template <class G, class P>
+bool cache_base_c::invalidate_impl(addr_t address, bool* was_dirty) {
+  addr_t line_num = address >> G::line_shift(m_line_shift);
+  int    idx      = line_num & G::set_mask(m_set_mask);
+  addr_t tag      = line_num >> G::set_shift(m_set_shift);
+
+  // a set that was never touched holds nothing
+  const uint64_t* words = find_words(idx);
+  int way = words ? find_way<G>(words, tag) : -1;
+  if (way >= 0) {
+    uint64_t& word = set_words<G>(idx)[way];
+    if (was_dirty) *was_dirty = tag_word::dirty(word);
+    word &= ~(tag_word::VALID | tag_word::DIRTY);
+    repl_set_s repl = repl_set<G>(idx);
+    P::on_invalidate(repl, way);
+    return true;
+  }
+  if (was_dirty) *was_dirty = false;
+  return false;
+}
+
+template <class G, class P>
+bool cache_base_c::install_writeback_impl(addr_t address,
+                                          addr_t *evict_addr,
+                                          bool   *evict_dirty) {
+  addr_t line_num = address >> G::line_shift(m_line_shift);
+  int    idx      = line_num & G::set_mask(m_set_mask);
+  addr_t tag      = line_num >> G::set_shift(m_set_shift);
+  uint64_t* words = set_words<G>(idx);
+
+  // check hit first
+  int way = find_way<G>(words, tag);
+  if (way >= 0) {
+    words[way] |= tag_word::DIRTY;
+    if (evict_addr)  *evict_addr  = 0;
+    if (evict_dirty) *evict_dirty = false;
+    return true;
+  }
+
+  repl_set_s repl = repl_set<G>(idx);
+  int victim = P::victim(repl);
+  evict<G>(idx, victim, evict_addr, evict_dirty);
+  words[victim] = tag_word::make(tag, true);
+
+  // place to LRU position (lowest priority) since this was not a demand access
+  P::on_insert_low(repl, victim);
+
+  return false;
+}
+
+/**
+ * Look up a line without touching the statistics or the replacement state.
+ * Lines of unsampled sets (set sampling) count as present, like their accesses.
+ */
+bool cache_base_c::probe(addr_t address) const {
+  if (is_unsampled(address)) return true;
+
+  addr_t line_num = address >> m_line_shift;
+  int    idx      = line_num & m_set_mask;
+  addr_t tag      = line_num >> m_set_shift;
+
+  const uint64_t* words = find_words(idx);
+  return words && find_way<generic_geometry_s>(words, tag) >= 0;
+}
+
+/**
+ * Write the line's data back without evicting it, e.g. when a coherence
+ * downgrade leaves a modified line shared.
+ */
+bool cache_base_c::clean(addr_t address) {
+  if (is_unsampled(address)) return false;
+
+  addr_t line_num = address >> m_line_shift;
+  int    idx      = line_num & m_set_mask;
+  addr_t tag      = line_num >> m_set_shift;
+
+  const uint64_t* words = find_words(idx);
+  int way = words ? find_way<generic_geometry_s>(words, tag) : -1;
+  if (way < 0) return false;
 
-    // install new
-    ve.m_valid = true;
-    ve.m_tag   = tag;
-    ve.m_dirty = is_write;
-    set->m_lru_list.push_front(victim);
+  uint64_t& word = set_words<generic_geometry_s>(idx)[way];
+  const bool was_dirty = tag_word::dirty(word);
+  word &= ~tag_word::DIRTY;
+  return was_dirty;
+}
+
+bool cache_base_c::lookup(addr_t address, int access_type) {
+  if (probe(address)) return access(address, access_type, /*is_fill*/false);
+
+  m_num_accesses++;
+  m_num_misses++;
+  if (access_type == WRITE) m_num_writes++;
+  if (m_set_sample_ratio > 1) m_set_accesses[(address >> m_line_shift) & m_set_mask]++;
+  if (m_num_sources) m_source_accesses[m_source]++;
+  return false;
+}
 
-    return false;
-    
-  ////////////////////////////////////////////////////////////////////
+void cache_base_c::get_valid_lines(std::vector<addr_t>* lines) const {
+  for (int set = 0; set < m_num_sets; ++set) {
+    const uint64_t* words = find_words(set);
+    if (!words) continue;
+    for (int way = 0; way < m_assoc; ++way) {
+      if (tag_word::valid(words[way]))
+        lines->push_back((tag_word::tag(words[way]) << m_set_shift) | set);
+    }
+  }
 }
 
 /**
@@ -173,6 +480,260 @@ void cache_base_c::print_stats() {
   std::cout << "number of writebacks: "  << m_num_writebacks << "\n";
 }
 
+cache_stats_s cache_base_c::get_stats() const {
+  cache_stats_s stats;
+  stats.m_num_accesses   = m_num_accesses;
+  stats.m_num_hits       = m_num_hits;
+  stats.m_num_misses     = m_num_misses;
+  stats.m_num_writes     = m_num_writes;
+  stats.m_num_writebacks = m_num_writebacks;
+  stats.m_num_unsampled  = m_num_unsampled;
+  return stats;
+}
+
+/**
+ * Zero the statistics; the tag store and replacement state are kept.
+ */
+void cache_base_c::reset_stats() {
+  m_num_accesses = 0;
+  m_num_hits = 0;
+  m_num_misses = 0;
+  m_num_writes = 0;
+  m_num_writebacks = 0;
+  m_num_unsampled = 0;
+  std::fill(m_source_accesses.begin(), m_source_accesses.end(), 0);
+  std::fill(m_source_hits.begin(), m_source_hits.end(), 0);
+}
+
+/**
+ * Add a statistics snapshot to this cache's (e.g., to merge the shards of a
+ * cache that was simulated in pieces).
+ */
+void cache_base_c::add_stats(const cache_stats_s& stats) {
+  m_num_accesses   += stats.m_num_accesses;
+  m_num_hits       += stats.m_num_hits;
+  m_num_misses     += stats.m_num_misses;
+  m_num_writes     += stats.m_num_writes;
+  m_num_writebacks += stats.m_num_writebacks;
+  m_num_unsampled  += stats.m_num_unsampled;
+}
+
+/**
+ * Count demand accesses per source from now on (source 0 until set_source()).
+ */
+void cache_base_c::set_num_sources(int num) {
+  m_num_sources = num;
+  m_source_accesses.assign(num, 0);
+  m_source_hits.assign(num, 0);
+  m_source_masks.clear();
+  set_source(0);
+}
+
+/**
+ * Partition the ways: a miss of source i only replaces a way whose bit is
+ * set in masks[i].  The masks may overlap but each must hold a way.
+ */
+void cache_base_c::set_way_masks(const std::vector<uint64_t>& masks) {
+  assert((masks.empty() || (int)masks.size() == get_num_sources()) && "one mask per source");
+  assert((masks.empty() || m_assoc <= 64) && "way masks cover at most 64 ways");
+  m_source_masks = masks;
+  set_source(m_source);
+}
+
+/**
+ * Turn on set sampling.  A set is simulated if a multiplicative hash of its
+ * index falls in one of "ratio" buckets, so the sampled sets are spread over
+ * the index space rather than clustered; at least one set is always sampled.
+ * Call before the first access.
+ */
+void cache_base_c::set_set_sampling(int ratio) {
+  m_set_sample_ratio = (ratio > 1) ? ratio : 1;
+  m_set_sampled.clear();
+  m_set_accesses.clear();
+  m_set_hits.clear();
+  if (m_set_sample_ratio == 1) return;
+
+  m_set_sampled.assign(m_num_sets, 0);
+  bool any = false;
+  for (int set = 0; set < m_num_sets; ++set) {
+    uint64_t hash = (uint64_t)set * 0x9E3779B97F4A7C15ULL;
+    m_set_sampled[set] = ((hash >> 32) % m_set_sample_ratio == 0);
+    any |= m_set_sampled[set];
+  }
+  if (!any) m_set_sampled[0] = 1;
+
+  m_set_accesses.assign(m_num_sets, 0);
+  m_set_hits.assign(m_num_sets, 0);
+}
+
+/**
+ * access() with set sampling on: references to unsampled sets are dropped,
+ * and demand accesses to sampled sets are also counted per set for the error
+ * estimate.
+ */
+bool cache_base_c::sampled_access(addr_t address, int access_type, bool is_fill,
+                                  addr_t *evict_addr, bool *evict_dirty) {
+  const int set = (address >> m_line_shift) & m_set_mask;
+  if (!m_set_sampled[set]) {
+    if (!is_fill) m_num_unsampled++;
+    if (evict_addr)  *evict_addr  = 0;
+    if (evict_dirty) *evict_dirty = false;
+    return true;
+  }
+
+  bool hit = (this->*m_access_fn)(address, access_type, is_fill, evict_addr, evict_dirty);
+  if (!is_fill) {
+    m_set_accesses[set]++;
+    if (hit) m_set_hits[set]++;
+  }
+  return hit;
+}
+
+/**
+ * Half-width of the 95% confidence interval of the hit rate (a fraction)
+ * under set sampling: a ratio estimator over the sampled sets, with the
+ * finite population correction for sampling sets without replacement.  The
+ * per-set counts behind it are not affected by reset_stats().
+ */
+double cache_base_c::get_hit_rate_error() const {
+  // Var(R) ~ (1 - n/N) / (n * mean(a)^2) * sum((h_i - R * a_i)^2) / (n - 1)
+  // over the n sampled sets i with a_i accesses and h_i hits
+  int num_sampled = 0;
+  double sum_a = 0.0, sum_h = 0.0;
+  for (int set = 0; set < (int)m_set_sampled.size(); ++set) {
+    if (!m_set_sampled[set]) continue;
+    num_sampled++;
+    sum_a += m_set_accesses[set];
+    sum_h += m_set_hits[set];
+  }
+  if (num_sampled < 2 || sum_a == 0) return 0.0;
+
+  const double ratio = sum_h / sum_a;
+  double sum_sq = 0.0;
+  for (int set = 0; set < m_num_sets; ++set) {
+    if (!m_set_sampled[set]) continue;
+    double resid = m_set_hits[set] - ratio * m_set_accesses[set];
+    sum_sq += resid * resid;
+  }
+
+  const double mean_a = sum_a / num_sampled;
+  const double var = (1.0 - (double)num_sampled / m_num_sets) / (num_sampled * mean_a * mean_a)
+                     * sum_sq / (num_sampled - 1);
+  return 1.96 * std::sqrt(var);
+}
+
+/**
+ * Whole-cache estimates from the sampled sets: counts are scaled by the
+ * fraction of references that went to sampled sets.
+ */
+void cache_base_c::print_sampling_stats() {
+  if (m_set_sample_ratio == 1) return;
+
+  int num_sampled = 0;
+  for (uint8_t sampled : m_set_sampled) num_sampled += sampled;
+
+  const double total = (double)m_num_accesses + m_num_unsampled;
+  const double scale = m_num_accesses ? total / m_num_accesses : 0.0;
+  const double ratio = m_num_accesses ? (double)m_num_hits / m_num_accesses : 0.0;
+  const double error = get_hit_rate_error();
+
+  std::cout << "------------------------------" << "\n";
+  std::cout << m_name << " Set Sampling" << "\n";
+  std::cout << "------------------------------" << "\n";
+  std::cout << "sampled sets: " << num_sampled << " of " << m_num_sets
+            << " (1 in " << m_set_sample_ratio << ")\n";
+  std::cout << "number of accesses (all sets): " << (uint64_t)total << "\n";
+  std::cout << "estimated hit rate: " << ratio * 100 << " +- " << error * 100
+            << " % (95% confidence)\n";
+  std::cout << "estimated hits: "       << (uint64_t)(m_num_hits * scale + 0.5) << "\n";
+  std::cout << "estimated misses: "     << (uint64_t)(m_num_misses * scale + 0.5) << "\n";
+  std::cout << "estimated writes: "     << (uint64_t)(m_num_writes * scale + 0.5) << "\n";
+  std::cout << "estimated writebacks: " << (uint64_t)(m_num_writebacks * scale + 0.5) << "\n";
+}
+
+/**
+ * Write this cache's checkpoint section (see checkpoint_format.h).  Pages of
+ * a sparse cache that were never touched are written in their initial state.
+ */
+bool cache_base_c::save_state(FILE* file) const {
+  checkpoint_format::cache_header_s header;
+  memset(&header, 0, sizeof(header));
+  header.num_sets     = m_num_sets;
+  header.assoc        = m_assoc;
+  header.line_size    = m_line_size;
+  header.repl_policy  = m_repl_policy;
+  header.set_sampling = m_set_sample_ratio;
+  header.psel         = m_psel;
+  header.rng          = m_rng;
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+  // all tag words first, then all replacement state
+  std::vector<uint64_t> fresh(m_page_words);
+  for (int pass = 0; pass < 2; ++pass) {
+    for (size_t ii = 0; ok && ii < m_num_pages; ++ii) {
+      const uint64_t* page = m_pages[ii];
+      if (!page) {
+        init_page(fresh.data(), ii);
+        page = fresh.data();
+      }
+      ok = (pass == 0) ? fwrite(page, sizeof(uint64_t), m_page_ways, file) == m_page_ways
+                       : fwrite(page + m_state_offset, sizeof(uint16_t), m_page_ways, file) == m_page_ways;
+    }
+  }
+
+  const size_t repl_bytes = (size_t)m_num_sets * m_assoc * sizeof(uint16_t);
+  const size_t padding    = checkpoint_format::align8(repl_bytes) - repl_bytes;
+  const uint64_t zero = 0;
+  return ok && fwrite(&zero, 1, padding, file) == padding;
+}
+
+/**
+ * Restore the tag store and replacement state from a checkpoint section.  The
+ * section must come from a cache with the same geometry, policy and set
+ * sampling; the statistics are left alone.  A sparse cache only allocates
+ * the pages that differ from their initial state.
+ */
+size_t cache_base_c::load_state(const char* data, size_t size) {
+  checkpoint_format::cache_header_s header;
+  if (size < sizeof(header)) return 0;
+  memcpy(&header, data, sizeof(header));
+
+  if ((int)header.num_sets != m_num_sets || (int)header.assoc != m_assoc ||
+      (int)header.line_size != m_line_size || (int)header.repl_policy != m_repl_policy ||
+      (int)header.set_sampling != m_set_sample_ratio)
+    return 0;
+
+  const size_t num_ways   = (size_t)m_num_sets * m_assoc;
+  const size_t tag_bytes  = num_ways * sizeof(uint64_t);
+  const size_t repl_bytes = num_ways * sizeof(uint16_t);
+  const size_t total = sizeof(header) + tag_bytes + checkpoint_format::align8(repl_bytes);
+  if (size < total) return 0;
+
+  const char*  words     = data + sizeof(header);
+  const char*  state     = words + tag_bytes;
+  const size_t word_bytes  = m_page_ways * sizeof(uint64_t);
+  const size_t state_bytes = m_page_ways * sizeof(uint16_t);
+  std::vector<uint64_t> fresh(m_page_words);
+  for (size_t ii = 0; ii < m_num_pages; ++ii) {
+    const char* page_words = words + ii * word_bytes;
+    const char* page_state = state + ii * state_bytes;
+
+    uint64_t* page = m_pages[ii];
+    if (!page) {
+      init_page(fresh.data(), ii);
+      if (memcmp(fresh.data(), page_words, word_bytes) == 0 &&
+          memcmp(fresh.data() + m_state_offset, page_state, state_bytes) == 0)
+        continue;
+      page = alloc_page(ii);
+    }
+    memcpy(page, page_words, word_bytes);
+    memcpy(page + m_state_offset, page_state, state_bytes);
+  }
+
+  m_psel = (int)header.psel;
+  m_rng  = header.rng;
+  return total;
+}
 
 /**
  * Dump tag store (for debugging) 
@@ -185,10 +746,12 @@ void cache_base_c::dump_tag_store(bool is_file) {
     os << "------------------------------" << "\n";
 
     for (int ii = 0; ii < m_num_sets; ii++) {
-      for (int jj = 0; jj < m_set[0]->m_assoc; jj++) {
-        os << "[" << (int)m_set[ii]->m_entry[jj].m_valid << ", ";
-        os << (int)m_set[ii]->m_entry[jj].m_dirty << ", ";
-        os << std::setw(10) << std::hex << m_set[ii]->m_entry[jj].m_tag << std::dec << "] ";
+      const uint64_t* words = find_words(ii);
+      for (int jj = 0; jj < m_assoc; jj++) {
+        const uint64_t word = words ? words[jj] : 0;
+        os << "[" << (int)tag_word::valid(word) << ", ";
+        os << (int)tag_word::dirty(word) << ", ";
+        os << std::setw(10) << std::hex << tag_word::tag(word) << std::dec << "] ";
       }
       os << "\n";
     }
@@ -201,79 +764,3 @@ void cache_base_c::dump_tag_store(bool is_file) {
     write(std::cout);
   }
 }
-
-bool cache_base_c::invalidate(addr_t address, bool* was_dirty)
-{
-    addr_t line_num = address / m_line_size;
-    int idx = line_num % m_num_sets;
-    addr_t tag = line_num / m_num_sets;
-
-    auto* set = m_set[idx];
-    for (int way = 0; way < set->m_assoc; ++way) {
-        auto& ent = set->m_entry[way];
-        if (ent.m_valid && ent.m_tag == tag) {
-            if (was_dirty) *was_dirty = ent.m_dirty;
-            ent.m_valid = false;
-            ent.m_dirty = false;
-            set->m_lru_list.remove(way);
-            set->m_lru_list.push_front(way);
-            return true;
-        }
-    }
-    if (was_dirty) *was_dirty = false;
-    return false;
-}
-
-bool cache_base_c::install_writeback(addr_t address,
-                                     addr_t *evict_addr,
-                                     bool   *evict_dirty)
-{
-    addr_t line_num = address / m_line_size;
-    int idx = line_num % m_num_sets;
-    addr_t tag = line_num / m_num_sets;
-
-    auto* set = m_set[idx];
-    // check hit first
-    for (int way = 0; way < set->m_assoc; ++way) {
-        auto &ent = set->m_entry[way];
-        if (ent.m_valid && ent.m_tag == tag) {
-            ent.m_dirty = true;
-            if (evict_addr)  *evict_addr  = 0;
-            if (evict_dirty) *evict_dirty = false;
-            return true;
-        }
-    }
-
-    // choose victim
-    int victim = -1;
-    for (int way : set->m_lru_list) {
-        if (!set->m_entry[way].m_valid) { victim = way; break; }
-    }
-    if (victim < 0) {
-        victim = set->m_lru_list.back();
-        set->m_lru_list.pop_back();
-    } else {
-        set->m_lru_list.remove(victim);
-    }
-
-    addr_t ev_line = 0; bool ev_dirty_flag = false;
-    auto &ve = set->m_entry[victim];
-    if (ve.m_valid) {
-        ev_line = (ve.m_tag * m_num_sets + idx) * (addr_t)m_line_size;
-        if (ve.m_dirty) {
-            m_num_writebacks++;
-            ev_dirty_flag = true;
-        }
-    }
-    if (evict_addr)  *evict_addr  = ev_line;
-    if (evict_dirty) *evict_dirty = ev_dirty_flag;
-
-    ve.m_valid = true;
-    ve.m_tag   = tag;
-    ve.m_dirty = true;
-
-    // place to LRU position since this was not a demand access
-    set->m_lru_list.push_back(victim);
-
-    return false;
-}
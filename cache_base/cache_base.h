@@ -5,8 +5,9 @@
 #define __CACHE_BASE_H__
 
 #include <cstdint>
+#include <cstdio>
 #include <string>
-#include <list>
+#include <vector>
 
 typedef enum request_type_enum {
   READ = 0,
@@ -17,40 +18,67 @@ typedef enum request_type_enum {
 using addr_t = uint64_t;
 
 ///////////////////////////////////////////////////////////////////
-class cache_entry_c
-{
-public:
-  cache_entry_c() {} ;
-  bool   m_valid;    // valid bit for the cacheline
-  bool   m_dirty;    // dirty bit 
-  addr_t m_tag;      // tag for the line
-  friend class cache_base_c;
-};
+/**
+ * Tag store entry encoding
+ *
+ * The whole tag store is a single array of 64-bit words indexed by
+ * (set * assoc + way).  Each word packs the line state into the low bits and
+ * the tag above them, so a lookup compares one word per way.
+ */
+namespace tag_word {
+  const uint64_t VALID = 0x1;    ///< valid bit for the cacheline
+  const uint64_t DIRTY = 0x2;    ///< dirty bit
+  const int      SHIFT = 2;      ///< tag starts above the state bits
 
-///////////////////////////////////////////////////////////////////
-class cache_set_c 
-{
-public:
-    cache_set_c(int assoc);
-    ~cache_set_c();
+  inline uint64_t make(addr_t tag, bool dirty) {
+    return (tag << SHIFT) | (dirty ? DIRTY : 0) | VALID;
+  }
+  inline addr_t tag(uint64_t word)   { return word >> SHIFT; }
+  inline bool   valid(uint64_t word) { return word & VALID; }
+  inline bool   dirty(uint64_t word) { return word & DIRTY; }
 
-    cache_entry_c *m_entry;  // array of cache entries. 
-    int m_assoc;             // number of cache blocks in a cache set
+  /// the value a valid entry holding "tag" has once the dirty bit is masked off
+  inline uint64_t key(addr_t tag) { return (tag << SHIFT) | VALID; }
+  const uint64_t KEY_MASK = ~DIRTY;
+}
 
-  ///////////////////////////////////////////////////////////////////
-  // TODO: Maintain the LRU stack for this set
+///////////////////////////////////////////////////////////////////
+/**
+ * Replacement policies of the tag store (see replacement.h)
+ */
+enum repl_policy_e {
+  REPL_LRU = 0,       ///< true LRU (default)
+  REPL_TREE_PLRU,     ///< binary-tree pseudo-LRU (power-of-two associativity)
+  REPL_BIT_PLRU,      ///< MRU-bit pseudo-LRU
+  REPL_SRRIP,         ///< static RRIP, 2-bit RRPV
+  REPL_DRRIP,         ///< dynamic RRIP (SRRIP/BRRIP set dueling)
+  REPL_RANDOM,        ///< random with a fixed seed
+  REPL_OPT,           ///< Belady OPT; the caller supplies next uses (set_next_use)
+  REPL_LAST
+};
 
-  std::list<int> m_lru_list;  // front=MRU, back=LRU
+int         parse_repl_policy(const std::string& name);  ///< policy for a config name, -1 if unknown
+const char* repl_policy_name(int policy);
 
-  ///////////////////////////////////////////////////////////////////
+struct repl_set_s;
+
+/// snapshot of the cache statistics (see cache_base_c::get_stats)
+struct cache_stats_s {
+  int m_num_accesses;
+  int m_num_hits;
+  int m_num_misses;
+  int m_num_writes;
+  int m_num_writebacks;
+  int m_num_unsampled;
 };
 
 ///////////////////////////////////////////////////////////////////
-class cache_base_c 
+class cache_base_c
 {
 public:
   cache_base_c();
-  cache_base_c(std::string name, int num_set, int assoc, int line_size);
+  cache_base_c(std::string name, int num_set, int assoc, int line_size,
+               int repl_policy = REPL_LRU, uint64_t repl_seed = 1, bool sparse = false);
   ~cache_base_c();
 
   // access/update tag store; optionally returns evicted block info
@@ -58,7 +86,18 @@ public:
                 int    access_type,
                 bool   is_fill,
                 addr_t *evict_addr = nullptr,
-                bool   *evict_dirty = nullptr);
+                bool   *evict_dirty = nullptr)
+    {
+        bool hit = (m_set_sample_ratio > 1) ?
+                   sampled_access(address, access_type, is_fill, evict_addr, evict_dirty) :
+                   (this->*m_access_fn)(address, access_type, is_fill,
+                                        evict_addr, evict_dirty);
+        if (!is_fill && m_num_sources) {
+          m_source_accesses[m_source]++;
+          if (hit) m_source_hits[m_source]++;
+        }
+        return hit;
+    }
 
     // shorthand for fill path
     bool fill(addr_t address,
@@ -73,29 +112,193 @@ public:
                       evict_dirty);
     }
   void print_stats();
+
+  // statistics snapshot/reset, e.g., to leave warm-up references out of the stats
+  cache_stats_s get_stats() const;
+  void reset_stats();
+  void add_stats(const cache_stats_s& stats);  // accumulate a snapshot (e.g., of another cache)
   void dump_tag_store(bool is_file);  // false: dump to stdout, true: dump to a file
 
   // invalidate the cacheline if present; return true if invalidated
-  bool invalidate(addr_t address, bool* was_dirty = nullptr);
+  bool invalidate(addr_t address, bool* was_dirty = nullptr) {
+    if (is_unsampled(address)) return false;
+    return (this->*m_invalidate_fn)(address, was_dirty);
+  }
 
   // install a write-back line without touching LRU stack
   bool install_writeback(addr_t address,
                          addr_t *evict_addr = nullptr,
-                         bool   *evict_dirty = nullptr);
+                         bool   *evict_dirty = nullptr) {
+    if (is_unsampled(address)) {
+      if (evict_addr)  *evict_addr  = 0;
+      if (evict_dirty) *evict_dirty = false;
+      return true;
+    }
+    return (this->*m_install_writeback_fn)(address, evict_addr, evict_dirty);
+  }
+
+  // set sampling: simulate only about 1 in "ratio" sets, chosen by a hash of
+  // the set index (ratio <= 1: every set).  A reference to any other set is
+  // dropped before the tag lookup: it behaves as a hit that changes nothing
+  // and is not counted in the stats, so only the hit rates are meaningful.
+  void set_set_sampling(int ratio);
+  int  get_set_sampling() const { return m_set_sample_ratio; }
+  bool is_unsampled(addr_t address) const {
+    return m_set_sample_ratio > 1 && !m_set_sampled[(address >> m_line_shift) & m_set_mask];
+  }
+  void print_sampling_stats();  // whole-cache estimates (nothing without set sampling)
+  double get_hit_rate_error() const;  // 95% half-width of the sampled hit rate (0: not sampled)
+
+  // checkpoints (see checkpoint_format.h): the tag store and replacement
+  // state, without the statistics or OPT next uses
+  bool   save_state(FILE* file) const;               // false on a write error
+  size_t load_state(const char* data, size_t size);  // bytes read; 0 if the section does not fit this cache
+
+  // true if the line holding "address" is in the cache (no stats or LRU update)
+  bool probe(addr_t address) const;
+
+  // clear the dirty bit of the line holding "address" (no stats or LRU
+  // update); return true if it was dirty
+  bool clean(addr_t address);
+
+  // demand access that allocates nothing on a miss (e.g., an exclusive
+  // cache, which only fills with victims); counted like access()
+  bool lookup(addr_t address, int access_type);
+
+  // line addresses (see get_line_addr) of every valid line
+  void get_valid_lines(std::vector<addr_t>* lines) const;
+
+  // cache line address (address without the line offset)
+  addr_t get_line_addr(addr_t address) const { return address >> m_line_shift; }
+
+  // per-source accounting and way partitioning: with "num" sources (e.g.,
+  // the cores sharing the cache), demand accesses are also counted for the
+  // source last passed to set_source(), and with way masks a miss only fills
+  // a way in the mask of that source (every way is still looked up)
+  void set_num_sources(int num);
+  void set_source(int source) {
+    m_source = source;
+    m_way_mask = m_source_masks.empty() ? ALL_WAYS : m_source_masks[source];
+  }
+  void set_way_masks(const std::vector<uint64_t>& masks);  // one per source; empty: no partitioning
+  int      get_num_sources() const { return m_num_sources; }
+  uint64_t get_source_accesses(int source) const { return m_source_accesses[source]; }
+  uint64_t get_source_hits(int source) const { return m_source_hits[source]; }
+  static const uint64_t ALL_WAYS = ~0ULL;
+
+  // OPT replacement: position of the next reference to the line of the
+  // upcoming access (NO_NEXT_USE if none); call before each access
+  static const uint64_t NO_NEXT_USE = UINT64_MAX;
+  void set_next_use(uint64_t next_use) { m_next_use = next_use; }
+
+  // true if this geometry runs on a kernel with compile-time line size/sets/assoc
+  bool is_specialized() const { return m_specialized; }
+  int  get_repl_policy() const { return m_repl_policy; }
+  int  get_num_sets() const { return m_num_sets; }
+  int  get_assoc() const { return m_assoc; }
+  int  get_line_size() const { return m_line_size; }
+  const std::string& get_name() const { return m_name; }
+  int  get_num_accesses() const { return m_num_accesses; }
+  int  get_num_hits() const { return m_num_hits; }
+
+  // sparse tag store: sets are allocated a page at a time on first touch
+  static const int SPARSE_PAGE_SETS = 64;
+  bool   is_sparse() const { return m_sparse; }
+  size_t get_num_allocated_sets() const { return m_num_allocated_pages << m_page_shift; }
+
+private:
+  // The lookup kernels are templated on a geometry policy that either returns
+  // the run-time values passed in or compile-time constants, and on a
+  // replacement policy (see cache_base.cc and replacement.h).  The
+  // constructor binds one instantiation per cache.
+  template <class G, class P> bool access_impl(addr_t address, int access_type, bool is_fill,
+                                               addr_t *evict_addr, bool *evict_dirty);
+  template <class G, class P> bool invalidate_impl(addr_t address, bool* was_dirty);
+  template <class G, class P> bool install_writeback_impl(addr_t address, addr_t *evict_addr,
+                                                          bool *evict_dirty);
+  template <class G, class P> void bind_kernels();
+  template <class G> void bind_policy();
+
+  cache_base_c(const cache_base_c&);             // not copyable (owns the pages)
+  cache_base_c& operator=(const cache_base_c&);
+
+  uint64_t* alloc_page(size_t page_num);                    ///< allocates an all-invalid page
+  void      init_page(uint64_t* page, size_t page_num) const;  ///< resets "page" to all-invalid
+  /// the page holding "set", allocated on first touch
+  uint64_t* page_of(int set) {
+    uint64_t* page = m_pages[set >> m_page_shift];
+    return page ? page : alloc_page(set >> m_page_shift);
+  }
+  /// tag words of "set", or nullptr if its page was never touched
+  const uint64_t* find_words(int set) const {
+    const uint64_t* page = m_pages[set >> m_page_shift];
+    return page ? page + (size_t)(set & m_page_mask) * m_assoc : nullptr;
+  }
+
+  template <class G> uint64_t* set_words(int set);              ///< tag words of a set
+  template <class G> int  find_way(const uint64_t* words, addr_t tag) const;  ///< way holding "tag" or -1
+  template <class G> repl_set_s repl_set(int set);              ///< replacement view of a set
+  template <class G> void evict(int set, int way, addr_t *evict_addr, bool *evict_dirty);
+
+  bool sampled_access(addr_t address, int access_type, bool is_fill,
+                      addr_t *evict_addr, bool *evict_dirty);
+
+  bool (cache_base_c::*m_access_fn)(addr_t, int, bool, addr_t*, bool*);
+  bool (cache_base_c::*m_invalidate_fn)(addr_t, bool*);
+  bool (cache_base_c::*m_install_writeback_fn)(addr_t, addr_t*, bool*);
+  void (*m_init_set_fn)(repl_set_s&);
 
 private:
   std::string m_name;     // cache name
   int m_num_sets;         // number of sets
+  int m_assoc;            // number of cache blocks in a cache set
   int m_line_size;        // cache line size
 
-  cache_set_c **m_set;    // cache data structure
+  int    m_line_shift;    ///< log2(line size)
+  int    m_set_shift;     ///< log2(number of sets)
+  addr_t m_set_mask;      ///< number of sets - 1
+  bool   m_specialized;   ///< bound to a compile-time geometry kernel
+
+  int      m_repl_policy; ///< repl_policy_e
+  int      m_psel;        ///< DRRIP policy selector
+  uint64_t m_rng;         ///< random state (random replacement, BRRIP)
+  uint64_t m_next_use;    ///< next use of the upcoming access (OPT)
+
+  int      m_num_sources;                   ///< sources counted (0: no per-source accounting)
+  int      m_source;                        ///< source of the upcoming access
+  uint64_t m_way_mask;                      ///< ways it may fill (ALL_WAYS: any)
+  std::vector<uint64_t> m_source_masks;     ///< way mask per source (empty: not partitioned)
+  std::vector<uint64_t> m_source_accesses;  ///< demand accesses per source
+  std::vector<uint64_t> m_source_hits;      ///< demand hits per source
+
+  // The tag store is split into pages of consecutive sets: the whole cache
+  // when dense, SPARSE_PAGE_SETS sets when sparse.  A page is one block of
+  // 64-bit words holding, for every way of its sets (set-major), the packed
+  // tag words, then the OPT next uses (OPT only), then the 16-bit
+  // replacement state (meaning depends on the policy).
+  bool       m_sparse;                   ///< pages are allocated on first touch
+  int        m_page_shift;               ///< log2(sets per page)
+  int        m_page_mask;                ///< sets per page - 1
+  size_t     m_page_ways;                ///< ways per page
+  size_t     m_page_words;               ///< 64-bit words per page
+  size_t     m_next_use_offset;          ///< next uses in a page (0: not OPT)
+  size_t     m_state_offset;             ///< replacement state in a page (in 64-bit words)
+  size_t     m_num_pages;
+  size_t     m_num_allocated_pages;
+  uint64_t** m_pages;                    ///< page directory (nullptr: never touched)
+
+  int m_set_sample_ratio;                  ///< simulate ~1 in this many sets (<= 1: all)
+  std::vector<uint8_t>  m_set_sampled;     ///< per set: simulated (set sampling only)
+  std::vector<uint64_t> m_set_accesses;    ///< per sampled set: demand accesses
+  std::vector<uint64_t> m_set_hits;        ///< per sampled set: demand hits
 
   // cache statistics
-  int m_num_accesses; 
-  int m_num_hits; 
-  int m_num_misses; 
+  int m_num_accesses;
+  int m_num_hits;
+  int m_num_misses;
   int m_num_writes;
   int m_num_writebacks;
+  int m_num_unsampled;    ///< demand accesses dropped by set sampling
 };
 
-#endif // !__CACHE_BASE_H__ 
+#endif // !__CACHE_BASE_H__
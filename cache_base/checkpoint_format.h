@@ -0,0 +1,54 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __CHECKPOINT_FORMAT_H__
+#define __CHECKPOINT_FORMAT_H__
+
+#include "trace_format.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Checkpoint file format
+ *
+ *   header : header_s (magic "L4CKPT\0\0", version, number of caches, the
+ *            instructions warmed, and the trace position to resume from)
+ *   caches : one section per cache, top level first:
+ *            cache_header_s, then the tag words (uint64, sets x assoc), then
+ *            the replacement state (uint16, sets x assoc) zero padded to a
+ *            multiple of 8 bytes
+ *
+ * Everything is little endian and every section starts on an 8-byte
+ * boundary, so a memory-mapped checkpoint is copied into the tag store with
+ * one memcpy per array.  The statistics are not part of a checkpoint.
+ */
+namespace checkpoint_format {
+  const char     MAGIC[8] = {'L', '4', 'C', 'K', 'P', 'T', '\0', '\0'};
+  const uint32_t VERSION  = 1;
+
+  struct header_s {
+    char     magic[8];
+    uint32_t version;
+    uint32_t num_caches;
+    uint64_t num_insts;                                ///< instructions before the checkpoint
+    uint64_t num_mem_insts;                            ///< memory instructions before the checkpoint
+    uint64_t trace_offset;                             ///< see trace_pos_s
+    uint64_t trace_prev_addr[trace_format::NUM_STREAMS];
+  };
+
+  struct cache_header_s {
+    uint32_t num_sets;
+    uint32_t assoc;
+    uint32_t line_size;
+    uint32_t repl_policy;
+    uint32_t set_sampling;
+    uint32_t reserved;
+    int64_t  psel;                                     ///< DRRIP policy selector
+    uint64_t rng;                                      ///< random replacement / BRRIP state
+  };
+
+  inline size_t align8(size_t size) { return (size + 7) & ~(size_t)7; }
+}
+
+#endif // !__CHECKPOINT_FORMAT_H__
@@ -0,0 +1,324 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __REPLACEMENT_H__
+#define __REPLACEMENT_H__
+
+#include "cache_base.h"
+
+/**
+ * Replacement policies for the tag store kernels (cache_base.cc).
+ *
+ * A policy is a set of static hooks that the kernels call with a view of one
+ * set.  Each way owns one 16-bit word of replacement state; the policy decides
+ * what it means (LRU rank, tree node bit, MRU bit, RRPV).  The hooks are
+ *
+ *   init_set(s)            reset the state of a set (all ways invalid)
+ *   victim(s)              way to replace on a miss; invalid ways come first
+ *   on_hit(s, way)         demand or fill access hit "way"
+ *   on_insert(s, way, d)   a missing line was installed in "way" (d: demand miss)
+ *   on_insert_low(s, way)  a write-back was installed in "way" (not an access)
+ *   on_invalidate(s, way)  "way" was invalidated
+ *
+ * LRU keeps the exact semantics of the original tag store, including the
+ * promotion of an invalidated way to MRU.
+ *
+ * With way partitioning, victim() only picks a way in "way_mask".
+ */
+struct repl_set_s {
+  uint16_t*       state;      ///< replacement state of the ways in this set
+  const uint64_t* words;      ///< tag words of the ways in this set
+  int             assoc;
+  int             set;        ///< set index
+  int             num_sets;
+  int*            psel;       ///< DRRIP policy selector (per cache)
+  uint64_t*       rng;        ///< random state (per cache)
+  uint64_t*       next_use;   ///< next use of the ways in this set (OPT only)
+  uint64_t        cur_next_use;  ///< next use of the line being accessed (OPT only)
+  uint64_t        way_mask;   ///< ways the victim may come from (ALL_WAYS: any)
+};
+
+namespace repl {
+  /// xorshift64*: cheap, deterministic for a given seed
+  inline uint64_t next_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+  }
+
+  /// true if the victim may be "way"
+  inline bool allowed(const repl_set_s& s, int way) {
+    return s.way_mask == cache_base_c::ALL_WAYS || ((s.way_mask >> way) & 1);
+  }
+
+  /// true if the victim may be one of the "num" ways from "first"
+  inline bool any_allowed(const repl_set_s& s, int first, int num) {
+    if (s.way_mask == cache_base_c::ALL_WAYS) return true;
+    const uint64_t range = (num >= 64) ? ~0ULL : ((1ULL << num) - 1);
+    return (s.way_mask >> first) & range;
+  }
+
+  /// lowest invalid way the victim may be, or -1
+  inline int find_invalid(const repl_set_s& s) {
+    const uint64_t mask = s.way_mask;
+    for (int way = 0; way < s.assoc; ++way)
+      if (!tag_word::valid(s.words[way]) && (mask == cache_base_c::ALL_WAYS || ((mask >> way) & 1)))
+        return way;
+    return -1;
+  }
+}
+
+/**
+ * True LRU: state is the LRU stack position (0 = MRU, assoc-1 = LRU).
+ */
+struct lru_policy_s {
+  static void init_set(repl_set_s& s) {
+    for (int way = 0; way < s.assoc; ++way) s.state[way] = way;
+  }
+
+  // the invalid way closest to the MRU position if there is one, the LRU way otherwise
+  static int victim(repl_set_s& s) {
+    if (s.way_mask != cache_base_c::ALL_WAYS) return masked_victim(s);
+
+    int victim = -1;
+    int lru    = 0;
+    for (int way = 0; way < s.assoc; ++way) {
+      if (!tag_word::valid(s.words[way]) && (victim < 0 || s.state[way] < s.state[victim]))
+        victim = way;
+      if (s.state[way] == s.assoc - 1) lru = way;
+    }
+    return (victim < 0) ? lru : victim;
+  }
+
+  // the same among the ways in the mask (way partitioning)
+  static int masked_victim(repl_set_s& s) {
+    int victim = -1;
+    int lru    = -1;
+    for (int way = 0; way < s.assoc; ++way) {
+      if (!repl::allowed(s, way)) continue;
+      if (!tag_word::valid(s.words[way]) && (victim < 0 || s.state[way] < s.state[victim]))
+        victim = way;
+      if (lru < 0 || s.state[way] > s.state[lru]) lru = way;
+    }
+    return (victim < 0) ? lru : victim;
+  }
+
+  static void move_to_mru(repl_set_s& s, int way) {
+    const uint16_t pos = s.state[way];
+    for (int ii = 0; ii < s.assoc; ++ii)
+      if (s.state[ii] < pos) s.state[ii]++;
+    s.state[way] = 0;
+  }
+
+  static void move_to_lru(repl_set_s& s, int way) {
+    const uint16_t pos = s.state[way];
+    for (int ii = 0; ii < s.assoc; ++ii)
+      if (s.state[ii] > pos) s.state[ii]--;
+    s.state[way] = s.assoc - 1;
+  }
+
+  static void on_hit(repl_set_s& s, int way)              { move_to_mru(s, way); }
+  static void on_insert(repl_set_s& s, int way, bool)     { move_to_mru(s, way); }
+  static void on_insert_low(repl_set_s& s, int way)       { move_to_lru(s, way); }
+  static void on_invalidate(repl_set_s& s, int way)       { move_to_mru(s, way); }
+};
+
+/**
+ * Tree pseudo-LRU: a binary tree over the ways (associativity must be a
+ * power of two).  Node i lives in state[i] with children 2i+1 and 2i+2; a
+ * node bit of 0 points the victim search left, 1 points it right.
+ */
+struct tree_plru_policy_s {
+  static void init_set(repl_set_s& s) {
+    for (int way = 0; way < s.assoc; ++way) s.state[way] = 0;
+  }
+
+  static int victim(repl_set_s& s) {
+    int way = repl::find_invalid(s);
+    if (way >= 0) return way;
+
+    // follow the node bits, but never into a subtree without an allowed way
+    int node = 0, first = 0, span = s.assoc;
+    while (node < s.assoc - 1) {
+      span /= 2;
+      int dir = s.state[node];
+      if (!repl::any_allowed(s, first + dir * span, span)) dir ^= 1;
+      first += dir * span;
+      node = 2 * node + 1 + dir;
+    }
+    return node - (s.assoc - 1);
+  }
+
+  // point every node on the path to "way" away from it (protect)...
+  static void touch(repl_set_s& s, int way) {
+    for (int node = way + s.assoc - 1; node > 0; node = (node - 1) / 2)
+      s.state[(node - 1) / 2] = (node & 1) ? 1 : 0;
+  }
+
+  // ...or towards it (next victim)
+  static void expose(repl_set_s& s, int way) {
+    for (int node = way + s.assoc - 1; node > 0; node = (node - 1) / 2)
+      s.state[(node - 1) / 2] = (node & 1) ? 0 : 1;
+  }
+
+  static void on_hit(repl_set_s& s, int way)              { touch(s, way); }
+  static void on_insert(repl_set_s& s, int way, bool)     { touch(s, way); }
+  static void on_insert_low(repl_set_s& s, int way)       { expose(s, way); }
+  static void on_invalidate(repl_set_s& s, int way)       { expose(s, way); }
+};
+
+/**
+ * Bit pseudo-LRU (MRU bits): an access sets the way's bit, and once every
+ * bit is set the others are cleared.  The victim is the first clear bit.
+ */
+struct bit_plru_policy_s {
+  static void init_set(repl_set_s& s) {
+    for (int way = 0; way < s.assoc; ++way) s.state[way] = 0;
+  }
+
+  static int victim(repl_set_s& s) {
+    int way = repl::find_invalid(s);
+    if (way >= 0) return way;
+
+    int first = -1;
+    for (way = 0; way < s.assoc; ++way) {
+      if (!repl::allowed(s, way)) continue;
+      if (!s.state[way]) return way;
+      if (first < 0) first = way;
+    }
+    return first;
+  }
+
+  static void touch(repl_set_s& s, int way) {
+    if (s.state[way]) return;   // already set, and never all of them are
+    s.state[way] = 1;
+    for (int ii = 0; ii < s.assoc; ++ii)
+      if (!s.state[ii]) return;
+    for (int ii = 0; ii < s.assoc; ++ii) s.state[ii] = (ii == way);
+  }
+
+  static void on_hit(repl_set_s& s, int way)              { touch(s, way); }
+  static void on_insert(repl_set_s& s, int way, bool)     { touch(s, way); }
+  static void on_insert_low(repl_set_s& s, int way)       { s.state[way] = 0; }
+  static void on_invalidate(repl_set_s& s, int way)       { s.state[way] = 0; }
+};
+
+/**
+ * Static RRIP with 2-bit re-reference prediction values: a hit predicts a
+ * near re-reference (0), a new line a long one (2), and the victim is a line
+ * with a distant prediction (3), aging the whole set until one exists.
+ */
+struct srrip_policy_s {
+  static const uint16_t RRPV_MAX = 3;
+
+  static void init_set(repl_set_s& s) {
+    for (int way = 0; way < s.assoc; ++way) s.state[way] = RRPV_MAX;
+  }
+
+  static int victim(repl_set_s& s) {
+    int way = repl::find_invalid(s);
+    if (way >= 0) return way;
+
+    uint16_t oldest = 0;
+    for (way = 0; way < s.assoc; ++way)
+      if (s.state[way] > oldest && repl::allowed(s, way)) oldest = s.state[way];
+
+    const uint16_t age = RRPV_MAX - oldest;
+    int victim = -1;
+    for (way = 0; way < s.assoc; ++way) {
+      s.state[way] += age;
+      if (victim < 0 && s.state[way] == RRPV_MAX && repl::allowed(s, way)) victim = way;
+    }
+    return victim;
+  }
+
+  static void on_hit(repl_set_s& s, int way)              { s.state[way] = 0; }
+  static void on_insert(repl_set_s& s, int way, bool)     { s.state[way] = RRPV_MAX - 1; }
+  static void on_insert_low(repl_set_s& s, int way)       { s.state[way] = RRPV_MAX; }
+  static void on_invalidate(repl_set_s& s, int way)       { s.state[way] = RRPV_MAX; }
+};
+
+/**
+ * Dynamic RRIP: SRRIP and bimodal RRIP (insert distant, long once in 32)
+ * duel on a few leader sets; a saturating selector counts the leaders'
+ * demand misses and the follower sets use whichever is missing less.
+ */
+struct drrip_policy_s : srrip_policy_s {
+  static const int PSEL_MAX     = 1023;  ///< 10-bit selector
+  static const int NUM_LEADERS  = 32;    ///< leader sets per policy (fewer in small caches)
+  static const int BRRIP_LONG   = 32;    ///< BRRIP inserts long once in this many
+
+  // 0: follower, 1: SRRIP leader, 2: BRRIP leader
+  static int leader_type(const repl_set_s& s) {
+    const int stride = (s.num_sets / NUM_LEADERS > 4) ? s.num_sets / NUM_LEADERS : 4;
+    const int offset = s.set % stride;
+    return (offset == 0) ? 1 : (offset == 1) ? 2 : 0;
+  }
+
+  static void on_insert(repl_set_s& s, int way, bool demand) {
+    const int leader = leader_type(s);
+    if (demand && leader == 1 && *s.psel < PSEL_MAX) (*s.psel)++;
+    if (demand && leader == 2 && *s.psel > 0)        (*s.psel)--;
+
+    bool brrip = (leader == 2) || (leader == 0 && *s.psel > PSEL_MAX / 2);
+    if (brrip && repl::next_random(s.rng) % BRRIP_LONG != 0)
+      s.state[way] = RRPV_MAX;
+    else
+      s.state[way] = RRPV_MAX - 1;
+  }
+};
+
+/**
+ * Random replacement from a per-cache seeded generator, so runs repeat.
+ */
+struct random_policy_s {
+  static void init_set(repl_set_s&) {}
+
+  static int victim(repl_set_s& s) {
+    int way = repl::find_invalid(s);
+    if (way >= 0) return way;
+    if (s.way_mask == cache_base_c::ALL_WAYS) return repl::next_random(s.rng) % s.assoc;
+
+    // the n-th allowed way
+    int n = repl::next_random(s.rng) % __builtin_popcountll(s.way_mask);
+    for (way = 0; ; ++way)
+      if (repl::allowed(s, way) && n-- == 0) return way;
+  }
+
+  static void on_hit(repl_set_s&, int)                    {}
+  static void on_insert(repl_set_s&, int, bool)           {}
+  static void on_insert_low(repl_set_s&, int)             {}
+  static void on_invalidate(repl_set_s&, int)             {}
+};
+
+/**
+ * Belady's OPT: evict the line whose next reference is furthest in the
+ * future (or that is never referenced again).  The caller computes the next
+ * use of every reference ahead of time and passes it in with
+ * cache_base_c::set_next_use(); the line keeps the next use of its latest
+ * reference.  Every missing line is installed (no bypass), like the other
+ * policies.
+ */
+struct opt_policy_s {
+  static void init_set(repl_set_s&) {}
+
+  static int victim(repl_set_s& s) {
+    int way = repl::find_invalid(s);
+    if (way >= 0) return way;
+
+    int victim = -1;
+    for (way = 0; way < s.assoc; ++way)
+      if (repl::allowed(s, way) && (victim < 0 || s.next_use[way] > s.next_use[victim])) victim = way;
+    return victim;
+  }
+
+  static void on_hit(repl_set_s& s, int way)              { s.next_use[way] = s.cur_next_use; }
+  static void on_insert(repl_set_s& s, int way, bool)     { s.next_use[way] = s.cur_next_use; }
+  static void on_insert_low(repl_set_s& s, int way)       { s.next_use[way] = cache_base_c::NO_NEXT_USE; }
+  static void on_invalidate(repl_set_s&, int)             {}
+};
+
+#endif // !__REPLACEMENT_H__
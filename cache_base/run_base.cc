@@ -2,11 +2,18 @@
 // Lab 4: Memory System Simulation
 
 #include "cache_base.h"
+#include "shard.h"
+#include "stack_dist.h"
+#include "sweep.h"
+#include "trace_reader.h"
 
 #include <cstdio>
+#include <cstdlib>
+#include <deque>
 #include <iostream>
-#include <fstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 /**
  * This function opens a trace file and feeds the trace to your cache
@@ -14,25 +21,260 @@
  * @param name - trace file name
  */
 void process_trace(cache_base_c* cache, const char* name) {
-  std::ifstream trace_file(name);
-  std::string line;
+  trace_reader_c trace;
 
   int type;
   addr_t address;
 
-  if (trace_file.is_open()) {
-    while (std::getline(trace_file, line)) {
-      std::sscanf(line.c_str(), "%d %lx", &type, &address);
+  if (trace.open(name)) {
+    while (trace.next(&type, &address)) {
       cache->access(address, type, 0);
     }
   }
 }
 
+// default OPT lookahead (references); the lookahead costs ~30 bytes each
+static const int OPT_WINDOW = 1 << 20;
+
+/**
+ * OPT mode: feeds the trace to an OPT cache and, for reference, an LRU cache
+ * of the same geometry.  The next use of each reference is found with a
+ * lookahead of "window" references: a reference is simulated once the reader
+ * is "window" references past it, so its next use is known if it falls in the
+ * window and is treated as "never" otherwise.  Memory is O(window) no matter
+ * how long the trace is; window 0 looks ahead over the whole trace (exact OPT,
+ * memory O(trace)).
+ * @param opt - cache with REPL_OPT
+ * @param lru - LRU cache with the same geometry
+ * @param name - trace file name
+ * @param window - lookahead in references (0: whole trace)
+ */
+void process_trace_opt(cache_base_c* opt, cache_base_c* lru, const char* name, size_t window) {
+  struct ref_s {
+    addr_t   addr;
+    int      type;
+    uint64_t next_use;
+  };
+
+  trace_reader_c trace;
+  if (!trace.open(name)) return;
+
+  std::deque<ref_s> ahead;                        // references [first, first + ahead.size())
+  std::unordered_map<addr_t, uint64_t> last_ref;  // line -> its latest reference in "ahead"
+  uint64_t first = 0;
+
+  auto retire = [&]() {
+    const ref_s& ref = ahead.front();
+    auto it = last_ref.find(opt->get_line_addr(ref.addr));
+    if (it->second == first) last_ref.erase(it);
+
+    opt->set_next_use(ref.next_use);
+    opt->access(ref.addr, ref.type, 0);
+    lru->access(ref.addr, ref.type, 0);
+    ahead.pop_front();
+    ++first;
+  };
+
+  int type;
+  addr_t address;
+  while (trace.next(&type, &address)) {
+    if (window && ahead.size() == window) retire();
+
+    const uint64_t pos = first + ahead.size();
+    ahead.push_back({address, type, cache_base_c::NO_NEXT_USE});
+
+    auto it = last_ref.emplace(opt->get_line_addr(address), pos);
+    if (!it.second) {
+      ahead[it.first->second - first].next_use = pos;
+      it.first->second = pos;
+    }
+  }
+  while (!ahead.empty()) retire();
+}
+
+// default largest cache size of the per-set miss-ratio curve
+static const uint64_t MRC_MAX_SIZE = 1 << 24;
+
+/**
+ * Miss-ratio curve mode: one pass over the trace prints the LRU miss ratio
+ * of every power-of-two cache size as CSV.  With associativity 0 the caches
+ * are fully associative (up to the footprint of the trace); otherwise they
+ * have the given associativity and 1, 2, 4, ... sets.  Either way the sizes
+ * stop at max_size (0: the footprint, or MRC_MAX_SIZE with an associativity).
+ */
+int run_mrc(const char* name, int line_size, int assoc, uint64_t max_size) {
+  trace_reader_c trace;
+  if (!trace.open(name)) {
+    fprintf(stderr, "[Error]: cannot open trace %s\n", name);
+    return -1;
+  }
+
+  int type;
+  addr_t address;
+  if (assoc == 0) {
+    stack_dist_c sd(line_size);
+    while (trace.next(&type, &address)) sd.access(address);
+    sd.print_csv(std::cout, max_size);
+  } else {
+    set_stack_dist_c sd(line_size, assoc, max_size ? max_size : MRC_MAX_SIZE);
+    while (trace.next(&type, &address)) sd.access(address);
+    sd.print_csv(std::cout);
+  }
+  return 0;
+}
+
+/**
+ * Sweep mode: runs every "<size>:<assoc>:<line size>[:<policy>[:<1-in-N sets>]]"
+ * given after "sweep [-j threads]" over a single decode of the trace and
+ * prints one CSV table (accesses/hits/misses of set-sampled caches cover the
+ * sampled sets only).  The number of worker threads defaults to the number
+ * of cores.
+ */
+int run_sweep(const char* name, int argc, char** argv) {
+  int num_threads = std::thread::hardware_concurrency();
+  int first = 0;
+  if (argc - first >= 2 && std::string(argv[first]) == "-j") {
+    num_threads = atoi(argv[first + 1]);
+    first += 2;
+  }
+
+  std::vector<sweep_config_s> configs;
+  for (int ii = first; ii < argc; ++ii) {
+    sweep_config_s config;
+    if (!parse_sweep_config(argv[ii], &config)) {
+      fprintf(stderr, "[Error]: bad configuration %s (expected <size>:<assoc>:<line size>[:<policy>[:<1-in-N sets>]] "
+                      "with power-of-two sizes; opt is not supported)\n", argv[ii]);
+      return -1;
+    }
+    configs.push_back(config);
+  }
+  if (configs.empty()) {
+    fprintf(stderr, "[Error]: no configurations to sweep\n");
+    return -1;
+  }
+
+  sweep_c sweep(configs, num_threads);
+  if (!sweep.run(name)) {
+    fprintf(stderr, "[Error]: cannot open trace %s\n", name);
+    return -1;
+  }
+  sweep.print_csv(std::cout);
+  return 0;
+}
+
+/**
+ * Sharded mode: "shard <threads> <size> <assoc> <line size> [policy]" splits
+ * the sets of one cache across <threads> workers and prints the same stats
+ * as the serial run.
+ */
+int run_sharded(const char* name, int argc, char** argv) {
+  auto is_pow2 = [](int v) { return v > 0 && (v & (v - 1)) == 0; };
+
+  if (argc != 4 && argc != 5) {
+    fprintf(stderr, "[Error]: expected shard <threads> <cache size> <associativity> "
+                    "<line size> [replacement policy]\n");
+    return -1;
+  }
+
+  int num_shards = atoi(argv[0]);
+  int cache_size = atoi(argv[1]);
+  int assoc      = atoi(argv[2]);
+  int line_size  = atoi(argv[3]);
+  int num_sets   = (assoc > 0 && line_size > 0) ? cache_size / (assoc * line_size) : 0;
+  if (!is_pow2(cache_size) || !is_pow2(assoc) || !is_pow2(line_size) || num_sets < 1) {
+    fprintf(stderr, "[Error]: cache size, associativity and line size must be powers of two "
+                    "with cache size >= associativity * line size\n");
+    return -1;
+  }
+  if (!is_pow2(num_shards) || num_shards > num_sets) {
+    fprintf(stderr, "[Error]: the number of threads must be a power of two "
+                    "no larger than the number of sets (%d)\n", num_sets);
+    return -1;
+  }
+
+  int repl_policy = (argc > 4) ? parse_repl_policy(argv[4]) : REPL_LRU;
+  if (repl_policy < 0 || !sharded_cache_c::is_shardable(repl_policy)) {
+    fprintf(stderr, "[Error]: replacement policy %s cannot be sharded "
+                    "(lru, tree_plru, bit_plru, srrip)\n", argv[4]);
+    return -1;
+  }
+
+  sharded_cache_c cache("L1", num_sets, assoc, line_size, repl_policy, num_shards);
+  if (!cache.run(name)) {
+    fprintf(stderr, "[Error]: cannot open trace %s\n", name);
+    return -1;
+  }
+  cache.print_stats();
+  return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char** argv) {
-  if (argc != 5) {
+  auto is_pow2 = [](long v) { return v > 0 && (v & (v - 1)) == 0; };
+
+  if (argc >= 3 && std::string(argv[2]) == "sweep")
+    return run_sweep(argv[1], argc - 3, argv + 3);
+  if (argc >= 3 && std::string(argv[2]) == "shard")
+    return run_sharded(argv[1], argc - 3, argv + 3);
+
+  // options in front of the usual arguments: "sample <1-in-N sets>" turns on
+  // set sampling, and "sparse" allocates the sets on first touch
+  auto drop_args = [&](int count) {
+    argv[count + 1] = argv[1];
+    argv[count]     = argv[0];
+    argv += count;
+    argc -= count;
+  };
+  int  set_sampling = 1;
+  bool sampled = false;
+  bool sparse = false;
+  while (argc >= 3) {
+    if (argc >= 4 && std::string(argv[2]) == "sample") {
+      set_sampling = atoi(argv[3]);
+      if (set_sampling < 1) {
+        fprintf(stderr, "[Error]: set sampling ratio must be at least 1\n");
+        return -1;
+      }
+      drop_args(2);
+      sampled = true;
+    } else if (std::string(argv[2]) == "sparse") {
+      sparse = true;
+      drop_args(1);
+    } else {
+      break;
+    }
+  }
+
+  if (argc >= 4 && argc <= 6 && std::string(argv[2]) == "mrc") {
+    if (sampled || sparse) {
+      fprintf(stderr, "[Error]: sample and sparse do not apply to mrc\n");
+      return -1;
+    }
+    long line_size = atol(argv[3]);
+    long assoc     = (argc > 4) ? atol(argv[4]) : 0;
+    long max_size  = (argc > 5) ? atol(argv[5]) : 0;
+    if (!is_pow2(line_size) || (assoc && !is_pow2(assoc)) || (argc > 5 && !is_pow2(max_size))) {
+      fprintf(stderr, "[Error]: line size, associativity and max cache size must be powers of two\n");
+      return -1;
+    }
+    return run_mrc(argv[1], line_size, assoc, max_size);
+  }
+
+  if (argc < 5 || argc > 7) {
     fprintf(stderr, "[Usage]: %s <trace> <cache size (in bytes)> <associativity> "
-                    "<line size (in bytes)> \n", argv[0]);
+                    "<line size (in bytes)> [replacement policy (default: lru)] "
+                    "[opt lookahead (in references, 0: whole trace; default: %d)]\n",
+            argv[0], OPT_WINDOW);
+    fprintf(stderr, "         %s <trace> mrc <line size (in bytes)> "
+                    "[associativity (0: fully associative)] "
+                    "[max cache size (default: the footprint, or %lu with an associativity)]\n",
+            argv[0], (unsigned long)MRC_MAX_SIZE);
+    fprintf(stderr, "         %s <trace> sweep [-j threads] "
+                    "<size>:<assoc>:<line size>[:<policy>[:<1-in-N sets>]] ...\n", argv[0]);
+    fprintf(stderr, "         %s <trace> [sample <1-in-N sets>] [sparse] <cache size (in bytes)> "
+                    "<associativity> <line size (in bytes)> [replacement policy]\n", argv[0]);
+    fprintf(stderr, "         %s <trace> shard <threads> <cache size (in bytes)> <associativity> "
+                    "<line size (in bytes)> [replacement policy]\n", argv[0]);
     return -1;
   }
   
@@ -45,12 +287,67 @@ int main(int argc, char** argv) {
   int cache_size = atoi(argv[2]);
   int assoc      = atoi(argv[3]);
   int line_size  = atoi(argv[4]);
-  int num_sets   = cache_size / (assoc * line_size);
+  int num_sets   = (assoc > 0 && line_size > 0) ? cache_size / (assoc * line_size) : 0;
+
+  // the tag store indexes with shifts and masks (see cache_base_c)
+  if (!is_pow2(cache_size) || !is_pow2(assoc) || !is_pow2(line_size) || num_sets < 1) {
+    fprintf(stderr, "[Error]: cache size, associativity and line size must be powers of two "
+                    "with cache size >= associativity * line size\n");
+    return -1;
+  }
+
+  int repl_policy = (argc > 5) ? parse_repl_policy(argv[5]) : REPL_LRU;
+  if (repl_policy < 0) {
+    fprintf(stderr, "[Error]: unknown replacement policy %s "
+                    "(lru, tree_plru, bit_plru, srrip, drrip, random, opt)\n", argv[5]);
+    return -1;
+  }
 
-  cache_base_c* cc = new cache_base_c("L1", num_sets, atoi(argv[3]), atoi(argv[4]));
+  if (argc > 6 && repl_policy != REPL_OPT) {
+    fprintf(stderr, "[Error]: the lookahead argument is only for the opt policy\n");
+    return -1;
+  }
+
+  if (repl_policy == REPL_OPT && set_sampling > 1) {
+    fprintf(stderr, "[Error]: opt cannot be combined with set sampling\n");
+    return -1;
+  }
+
+  cache_base_c* cc = new cache_base_c("L1", num_sets, atoi(argv[3]), atoi(argv[4]), repl_policy,
+                                      1, sparse);
+  cc->set_set_sampling(set_sampling);
+
+  if (repl_policy == REPL_OPT) {
+    long window = (argc > 6) ? atol(argv[6]) : OPT_WINDOW;
+    if (window < 0) {
+      fprintf(stderr, "[Error]: opt lookahead must not be negative\n");
+      return -1;
+    }
+
+    cache_base_c lru("LRU", num_sets, assoc, line_size, REPL_LRU, 1, sparse);
+    process_trace_opt(cc, &lru, argv[1], window);
+    cc->print_stats();
+
+    double opt_rate = (double)cc->get_num_hits() / cc->get_num_accesses() * 100;
+    double lru_rate = (double)lru.get_num_hits() / lru.get_num_accesses() * 100;
+    std::cout << "------------------------------" << "\n";
+    std::cout << "OPT vs LRU (lookahead " << window << ")\n";
+    std::cout << "------------------------------" << "\n";
+    std::cout << "LRU hit rate: "          << lru_rate << " % \n";
+    std::cout << "OPT hit rate: "          << opt_rate << " % \n";
+    std::cout << "gap: "                   << opt_rate - lru_rate << " % \n";
+    std::cout << "LRU misses: "            << lru.get_num_accesses() - lru.get_num_hits() << "\n";
+    std::cout << "OPT misses: "            << cc->get_num_accesses() - cc->get_num_hits() << "\n";
+    delete cc;
+    return 0;
+  }
 
   process_trace(cc, argv[1]);
   cc->print_stats();
+  cc->print_sampling_stats();
+  if (sparse)
+    std::cout << "sets allocated (sparse): " << cc->get_num_allocated_sets()
+              << " of " << num_sets << "\n";
   //cc->dump_tag_store(false);
   delete cc;
 
@@ -0,0 +1,103 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "shard.h"
+
+#include <thread>
+
+static int log2_int(int v) {
+  int shift = 0;
+  while (v > 1) { v >>= 1; ++shift; }
+  return shift;
+}
+
+sharded_cache_c::sharded_cache_c(std::string name, int num_sets, int assoc, int line_size,
+                                 int repl_policy, int num_shards, int depth, int block_size)
+    : m_name(name), m_line_shift(log2_int(line_size)), m_shard_shift(log2_int(num_shards)),
+      m_depth(depth), m_block_size(block_size), m_shards(num_shards) {
+  for (shard_s& shard : m_shards) {
+    shard.m_cache = new cache_base_c(name, num_sets / num_shards, assoc, line_size, repl_policy);
+    shard.m_ring.init(m_depth);
+    for (int ii = 0; ii < m_depth; ++ii) {
+      shard.m_ring.get(ii).m_rec.resize(m_block_size);
+      shard.m_ring.get(ii).m_len = 0;
+    }
+    shard.m_fill = 0;
+  }
+}
+
+sharded_cache_c::~sharded_cache_c() {
+  for (shard_s& shard : m_shards) delete shard.m_cache;
+}
+
+// DRRIP's selector and the random generator are shared by all sets, and OPT
+// needs next uses
+bool sharded_cache_c::is_shardable(int repl_policy) {
+  return repl_policy == REPL_LRU || repl_policy == REPL_TREE_PLRU ||
+         repl_policy == REPL_BIT_PLRU || repl_policy == REPL_SRRIP;
+}
+
+/**
+ * Worker thread: runs the shard's blocks through its cache in order.
+ */
+void sharded_cache_c::work(shard_s* shard) {
+  cache_base_c* cache = shard->m_cache;
+  for (uint64_t seq = 0; shard->m_ring.wait(seq); ++seq) {
+    const block_s& block = shard->m_ring.get(seq);
+    for (size_t ii = 0; ii < block.m_len; ++ii)
+      cache->access(block.m_rec[ii].m_addr, block.m_rec[ii].m_type, 0);
+    shard->m_ring.release(seq);
+  }
+}
+
+void sharded_cache_c::publish(shard_s* shard) {
+  shard->m_ring.get(shard->m_ring.get_tail()).m_len = shard->m_fill;
+  shard->m_ring.publish();
+  shard->m_fill = 0;
+}
+
+/**
+ * Decodes the trace in the calling thread and routes each reference to the
+ * shard that owns its set.  A shard's block is published when it fills up;
+ * the decoder waits for a free slot before it starts the next one.
+ */
+bool sharded_cache_c::run(const std::string& fname) {
+  trace_reader_c reader;
+  if (!reader.open(fname)) return false;
+
+  std::vector<std::thread> workers;
+  for (shard_s& shard : m_shards)
+    workers.push_back(std::thread(&sharded_cache_c::work, this, &shard));
+
+  const addr_t shard_mask = m_shards.size() - 1;
+  int type;
+  addr_t address;
+  while (reader.next(&type, &address)) {
+    const addr_t line = address >> m_line_shift;
+    shard_s& shard = m_shards[line & shard_mask];
+
+    if (shard.m_fill == 0) {
+      while (shard.m_ring.is_full())
+        std::this_thread::yield();
+    }
+
+    trace_record_s& rec = shard.m_ring.get(shard.m_ring.get_tail()).m_rec[shard.m_fill];
+    rec.m_type = type;
+    rec.m_addr = (line >> m_shard_shift) << m_line_shift;
+    if (++shard.m_fill == (size_t)m_block_size) publish(&shard);
+  }
+
+  for (shard_s& shard : m_shards) {
+    if (shard.m_fill) publish(&shard);
+    shard.m_ring.finish();
+  }
+
+  for (std::thread& worker : workers) worker.join();
+  return true;
+}
+
+void sharded_cache_c::print_stats() {
+  cache_base_c merged(m_name, 1, 1, 1 << m_line_shift);
+  for (shard_s& shard : m_shards) merged.add_stats(shard.m_cache->get_stats());
+  merged.print_stats();
+}
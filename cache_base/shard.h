@@ -0,0 +1,68 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __SHARD_H__
+#define __SHARD_H__
+
+#include "block_ring.h"
+#include "cache_base.h"
+#include "trace_prefetcher.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * @class sharded_cache_c
+ *
+ * Simulates one cache with its sets split across worker threads.  Sets are
+ * independent under the per-set replacement policies, so shard k owns the
+ * sets whose low log2(N) index bits equal k and simulates them as a cache of
+ * num_sets / N sets: it is fed the line address shifted right by log2(N),
+ * which keeps the tag and maps set s to set s >> log2(N).
+ *
+ * The calling thread decodes the trace and routes every reference to its
+ * shard through a single-producer/single-consumer ring of record blocks per
+ * shard.  The shard statistics are merged at the end, so the result equals
+ * the serial run exactly.
+ */
+class sharded_cache_c {
+public:
+  /// num_shards must be a power of two no larger than num_sets
+  sharded_cache_c(std::string name, int num_sets, int assoc, int line_size, int repl_policy,
+                  int num_shards, int depth = 16, int block_size = 4096);
+  ~sharded_cache_c();
+
+  /// true if every set of "repl_policy" is independent of the others
+  static bool is_shardable(int repl_policy);
+
+  bool run(const std::string& fname);       ///< returns false if the trace cannot be opened
+  void print_stats();                       ///< merged statistics (cache_base_c format)
+
+private:
+  sharded_cache_c(const sharded_cache_c&);             // not copyable
+  sharded_cache_c& operator=(const sharded_cache_c&);
+
+  struct block_s {
+    std::vector<trace_record_s> m_rec;
+    size_t m_len;
+  };
+
+  struct shard_s {
+    cache_base_c*         m_cache;
+    block_ring_c<block_s> m_ring;           ///< decoder to worker
+    size_t                m_fill;           ///< records in the block being filled (decoder)
+  };
+
+  void work(shard_s* shard);                ///< worker thread
+  void publish(shard_s* shard);             ///< hands the block being filled to the worker
+
+  std::string m_name;
+  int m_line_shift;                         ///< log2(line size)
+  int m_shard_shift;                        ///< log2(number of shards)
+  int m_depth;                              ///< ring depth in blocks
+  int m_block_size;                         ///< records per block
+
+  std::vector<shard_s> m_shards;
+};
+
+#endif // !__SHARD_H__
@@ -0,0 +1,178 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "stack_dist.h"
+
+#include <algorithm>
+#include <cstring>
+
+static const uint64_t INITIAL_TIMESTAMPS = 1 << 16;
+
+static int log2_int(uint64_t v) {
+  int shift = 0;
+  while (v > 1) { v >>= 1; ++shift; }
+  return shift;
+}
+
+static void print_csv_header(std::ostream& os) {
+  os << "cache_size,line_size,assoc,sets,accesses,misses,miss_ratio\n";
+}
+
+static void print_csv_row(std::ostream& os, uint64_t size, int line_size, uint64_t assoc,
+                          uint64_t sets, uint64_t accesses, uint64_t misses) {
+  os << size << "," << line_size << "," << assoc << "," << sets << ","
+     << accesses << "," << misses << ","
+     << (accesses ? (double)misses / accesses : 0.0) << "\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// stack_dist_c
+////////////////////////////////////////////////////////////////////////////////
+
+stack_dist_c::stack_dist_c(int line_size) {
+  m_line_shift = log2_int(line_size);
+  m_tree.assign(INITIAL_TIMESTAMPS + 1, 0);
+  m_line_at.assign(INITIAL_TIMESTAMPS, 0);
+  m_time = 0;
+  m_num_accesses = 0;
+  m_num_cold = 0;
+  memset(m_hist, 0, sizeof(m_hist));
+}
+
+void stack_dist_c::add(uint64_t pos, int delta) {
+  for (uint64_t ii = pos + 1; ii < m_tree.size(); ii += ii & (~ii + 1))
+    m_tree[ii] += delta;
+}
+
+uint64_t stack_dist_c::prefix_sum(uint64_t pos) const {
+  uint64_t sum = 0;
+  for (uint64_t ii = pos; ii > 0; ii -= ii & (~ii + 1))
+    sum += m_tree[ii];
+  return sum;
+}
+
+/**
+ * Renumber the latest access of every line to 0..footprint-1 (keeping their
+ * order) and rebuild the tree; the tree doubles if it would be more than half
+ * full afterwards.
+ */
+void stack_dist_c::compact() {
+  uint64_t num_live = 0;
+  for (uint64_t pos = 0; pos < m_time; ++pos) {
+    auto it = m_last.find(m_line_at[pos]);
+    if (it->second != pos) continue;
+    it->second = num_live;
+    m_line_at[num_live++] = m_line_at[pos];
+  }
+  m_time = num_live;
+
+  uint64_t capacity = m_line_at.size();
+  if (num_live * 2 > capacity) {
+    capacity *= 2;
+    m_line_at.resize(capacity);
+  }
+
+  // node ii covers timestamps [ii - lowbit(ii), ii), and exactly the first
+  // num_live of them are set
+  m_tree.assign(capacity + 1, 0);
+  for (uint64_t ii = 1; ii <= capacity; ++ii) {
+    uint64_t first = ii - (ii & (~ii + 1));
+    m_tree[ii] = (num_live > first) ? std::min(ii, num_live) - first : 0;
+  }
+}
+
+void stack_dist_c::access(addr_t address) {
+  if (m_time == m_line_at.size()) compact();
+
+  const addr_t line = address >> m_line_shift;
+  ++m_num_accesses;
+
+  auto it = m_last.find(line);
+  if (it == m_last.end()) {
+    ++m_num_cold;
+    m_last.emplace(line, m_time);
+  } else {
+    // distinct lines touched since the previous access to this line
+    const uint64_t prev = it->second;
+    const uint64_t dist = prefix_sum(m_time) - prefix_sum(prev + 1);
+    m_hist[dist ? log2_int(dist) + 1 : 0]++;
+    add(prev, -1);
+    it->second = m_time;
+  }
+
+  add(m_time, 1);
+  m_line_at[m_time++] = line;
+}
+
+void stack_dist_c::print_csv(std::ostream& os, uint64_t max_size) const {
+  const int line_size = 1 << m_line_shift;
+  print_csv_header(os);
+
+  // a cache of 2^k lines misses on the cold references and on distances >= 2^k
+  for (int k = 0; k < 64; ++k) {
+    uint64_t misses = m_num_cold;
+    for (int bucket = k + 1; bucket < 65; ++bucket) misses += m_hist[bucket];
+
+    const uint64_t lines = 1ULL << k;
+    if (max_size && lines * line_size > max_size) break;
+    print_csv_row(os, lines * line_size, line_size, lines, 1, m_num_accesses, misses);
+    if (lines >= m_last.size()) break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// set_stack_dist_c
+////////////////////////////////////////////////////////////////////////////////
+
+set_stack_dist_c::set_stack_dist_c(int line_size, int assoc, uint64_t max_size) {
+  m_line_shift = log2_int(line_size);
+  m_line_size = line_size;
+  m_assoc = assoc;
+  m_num_accesses = 0;
+
+  for (uint64_t sets = 1; sets * assoc * line_size <= max_size; sets *= 2) {
+    level_s level;
+    level.num_sets = sets;
+    level.stack.assign(sets * assoc, 0);
+    level.depth.assign(sets, 0);
+    level.hist.assign(assoc, 0);
+    m_levels.push_back(level);
+  }
+}
+
+void set_stack_dist_c::access(addr_t address) {
+  const addr_t line = address >> m_line_shift;
+  ++m_num_accesses;
+
+  for (level_s& level : m_levels) {
+    const int set = line & (level.num_sets - 1);
+    addr_t* stack = &level.stack[(size_t)set * m_assoc];
+    int&    depth = level.depth[set];
+
+    int pos = 0;
+    while (pos < depth && stack[pos] != line) ++pos;
+
+    if (pos < depth) {
+      level.hist[pos]++;
+    } else if (depth < m_assoc) {
+      pos = depth++;
+    } else {
+      pos = m_assoc - 1;   // drop the LRU line
+    }
+
+    for (; pos > 0; --pos) stack[pos] = stack[pos - 1];
+    stack[0] = line;
+  }
+}
+
+void set_stack_dist_c::print_csv(std::ostream& os) const {
+  print_csv_header(os);
+
+  for (const level_s& level : m_levels) {
+    uint64_t hits = 0;
+    for (uint64_t count : level.hist) hits += count;
+
+    print_csv_row(os, (uint64_t)level.num_sets * m_assoc * m_line_size, m_line_size,
+                  m_assoc, level.num_sets, m_num_accesses, m_num_accesses - hits);
+  }
+}
@@ -0,0 +1,88 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __STACK_DIST_H__
+#define __STACK_DIST_H__
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+using addr_t = uint64_t;
+
+/**
+ * @class stack_dist_c
+ *
+ * Mattson stack distances for a fully associative LRU cache.  One pass over
+ * the trace gives the LRU miss ratio of every cache size: a reference hits
+ * in a cache of C lines exactly when fewer than C distinct lines were
+ * touched since the previous reference to its line.
+ *
+ * The distance is counted with a Fenwick tree over access timestamps, which
+ * holds a 1 at the latest access of every line, so a reference costs
+ * O(log footprint).  Timestamps are compacted once the tree is full, so
+ * memory is O(footprint) however long the trace is.
+ */
+class stack_dist_c {
+public:
+  explicit stack_dist_c(int line_size);
+
+  void access(addr_t address);
+
+  /// CSV rows, one per power-of-two size from one line up to the footprint
+  /// (or up to max_size bytes, if smaller; 0: no limit)
+  void print_csv(std::ostream& os, uint64_t max_size = 0) const;
+
+private:
+  void     add(uint64_t pos, int delta);
+  uint64_t prefix_sum(uint64_t pos) const;   ///< ones in [0, pos)
+  void     compact();
+
+  int m_line_shift;
+
+  std::vector<uint32_t> m_tree;              ///< Fenwick tree over timestamps (1-based)
+  std::vector<addr_t>   m_line_at;           ///< line accessed at each timestamp
+  std::unordered_map<addr_t, uint64_t> m_last;  ///< line -> timestamp of its latest access
+  uint64_t m_time;                           ///< next timestamp
+
+  uint64_t m_num_accesses;
+  uint64_t m_num_cold;                       ///< first references (infinite distance)
+  uint64_t m_hist[65];                       ///< distance d counted in bucket (d ? log2(d) + 1 : 0)
+};
+
+/**
+ * @class set_stack_dist_c
+ *
+ * Per-set stack distances for a set-associative LRU cache of a chosen
+ * associativity.  Sets are selected by the low line address bits as in
+ * cache_base_c, so every power-of-two number of sets is simulated in the
+ * same pass with a per-set LRU stack of "assoc" lines; a reference hits in
+ * the cache with that many sets if its per-set distance is below assoc.
+ */
+class set_stack_dist_c {
+public:
+  set_stack_dist_c(int line_size, int assoc, uint64_t max_size);
+
+  void access(addr_t address);
+
+  /// CSV rows, one per power-of-two size from assoc lines up to max_size
+  void print_csv(std::ostream& os) const;
+
+private:
+  struct level_s {
+    int                   num_sets;
+    std::vector<addr_t>   stack;             ///< per-set LRU stacks, MRU first
+    std::vector<int>      depth;             ///< valid lines per set
+    std::vector<uint64_t> hist;              ///< per-set distance 0..assoc-1
+  };
+
+  int m_line_shift;
+  int m_line_size;
+  int m_assoc;
+
+  std::vector<level_s> m_levels;             ///< 1, 2, 4, ... sets
+  uint64_t m_num_accesses;
+};
+
+#endif // !__STACK_DIST_H__
@@ -0,0 +1,121 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "sweep.h"
+
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+bool parse_sweep_config(const std::string& spec, sweep_config_s* config) {
+  std::vector<std::string> fields;
+  std::stringstream ss(spec);
+  std::string field;
+  while (std::getline(ss, field, ':')) fields.push_back(field);
+  if (fields.size() < 3 || fields.size() > 5) return false;
+
+  config->cache_size  = atoi(fields[0].c_str());
+  config->assoc       = atoi(fields[1].c_str());
+  config->line_size   = atoi(fields[2].c_str());
+  config->repl_policy = (fields.size() > 3) ? parse_repl_policy(fields[3]) : REPL_LRU;
+  config->set_sampling = (fields.size() > 4) ? atoi(fields[4].c_str()) : 1;
+
+  // the tag store indexes with shifts and masks; OPT needs next uses
+  auto is_pow2 = [](int v) { return v > 0 && (v & (v - 1)) == 0; };
+  return is_pow2(config->cache_size) && is_pow2(config->assoc) && is_pow2(config->line_size) &&
+         config->cache_size >= config->assoc * config->line_size &&
+         config->repl_policy >= 0 && config->repl_policy != REPL_OPT && config->set_sampling >= 1;
+}
+
+sweep_c::sweep_c(const std::vector<sweep_config_s>& configs, int num_threads,
+                 int depth, int block_size)
+    : m_configs(configs), m_depth(depth), m_block_size(block_size) {
+  for (const sweep_config_s& config : m_configs) {
+    int num_sets = config.cache_size / (config.assoc * config.line_size);
+    m_caches.push_back(new cache_base_c("L1", num_sets, config.assoc, config.line_size,
+                                        config.repl_policy));
+    m_caches.back()->set_set_sampling(config.set_sampling);
+  }
+
+  m_num_workers = (num_threads < 1) ? 1 : num_threads;
+  if (m_num_workers > (int)m_configs.size()) m_num_workers = m_configs.size();
+
+  m_ring.init(m_depth, m_num_workers);
+  for (int ii = 0; ii < m_depth; ++ii) {
+    m_ring.get(ii).m_rec.resize(m_block_size);
+    m_ring.get(ii).m_len = 0;
+  }
+}
+
+sweep_c::~sweep_c() {
+  for (cache_base_c* cache : m_caches) delete cache;
+}
+
+/**
+ * Worker thread: takes every block in order and runs it through each of its
+ * caches in turn, so a cache stays hot for a whole block.
+ */
+void sweep_c::work(int worker) {
+  for (uint64_t seq = 0; m_ring.wait(seq); ++seq) {
+    const block_s& block = m_ring.get(seq);
+    for (size_t ii = worker; ii < m_caches.size(); ii += m_num_workers) {
+      cache_base_c* cache = m_caches[ii];
+      for (size_t jj = 0; jj < block.m_len; ++jj)
+        cache->access(block.m_rec[jj].m_addr, block.m_rec[jj].m_type, 0);
+    }
+    m_ring.release(seq);
+  }
+}
+
+/**
+ * Decodes the trace into the ring in the calling thread while the workers
+ * consume it; a slot is reused only after every worker has released it.
+ */
+bool sweep_c::run(const std::string& fname) {
+  trace_reader_c reader;
+  if (!reader.open(fname)) return false;
+
+  std::vector<std::thread> workers;
+  for (int ii = 0; ii < m_num_workers; ++ii)
+    workers.push_back(std::thread(&sweep_c::work, this, ii));
+
+  while (true) {
+    while (m_ring.is_full())
+      std::this_thread::yield();
+    block_s& block = m_ring.get(m_ring.get_tail());
+
+    size_t len = 0;
+    int type;
+    addr_t address;
+    while (len < (size_t)m_block_size && reader.next(&type, &address)) {
+      block.m_rec[len].m_type = type;
+      block.m_rec[len].m_addr = address;
+      ++len;
+    }
+    block.m_len = len;
+    if (len) m_ring.publish();
+    if (len < (size_t)m_block_size) break;
+  }
+  m_ring.finish();
+
+  for (std::thread& worker : workers) worker.join();
+  return true;
+}
+
+void sweep_c::print_csv(std::ostream& os) const {
+  os << "cache_size,line_size,assoc,sets,policy,accesses,hits,misses,hit_rate,"
+        "set_sampling,hit_rate_error\n";
+  for (size_t ii = 0; ii < m_configs.size(); ++ii) {
+    const sweep_config_s& config = m_configs[ii];
+    const cache_base_c*   cache  = m_caches[ii];
+    const int accesses = cache->get_num_accesses();
+    const int hits     = cache->get_num_hits();
+
+    os << config.cache_size << "," << config.line_size << "," << config.assoc << ","
+       << config.cache_size / (config.assoc * config.line_size) << ","
+       << repl_policy_name(config.repl_policy) << ","
+       << accesses << "," << hits << "," << accesses - hits << ","
+       << (accesses ? (double)hits / accesses * 100 : 0.0) << ","
+       << config.set_sampling << "," << cache->get_hit_rate_error() * 100 << "\n";
+  }
+}
@@ -0,0 +1,69 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include "block_ring.h"
+#include "cache_base.h"
+#include "trace_prefetcher.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/// one cache configuration of a sweep
+struct sweep_config_s {
+  int cache_size;
+  int assoc;
+  int line_size;
+  int repl_policy;
+  int set_sampling;     ///< simulate ~1 in this many sets (1: all)
+};
+
+/// parses "<size>:<assoc>:<line size>[:<policy>[:<1-in-N sets>]]"; returns false if malformed
+bool parse_sweep_config(const std::string& spec, sweep_config_s* config);
+
+/**
+ * @class sweep_c
+ *
+ * Simulates many cache configurations over one decode of the trace.  The
+ * calling thread decodes the trace into a ring of blocks, and each block is
+ * broadcast to a pool of worker threads; a worker owns a fixed subset of the
+ * configurations (one cache_base_c each) and runs every block through them.
+ * A block is refilled once all workers have released it.
+ */
+class sweep_c {
+public:
+  sweep_c(const std::vector<sweep_config_s>& configs, int num_threads,
+          int depth = 16, int block_size = 4096);
+  ~sweep_c();
+
+  bool run(const std::string& fname);       ///< returns false if the trace cannot be opened
+
+  /// CSV rows, one per configuration in the order given
+  void print_csv(std::ostream& os) const;
+
+  int get_num_workers() const { return m_num_workers; }
+
+private:
+  sweep_c(const sweep_c&);                  // not copyable
+  sweep_c& operator=(const sweep_c&);
+
+  struct block_s {
+    std::vector<trace_record_s> m_rec;
+    size_t m_len;
+  };
+
+  void work(int worker);                    ///< worker thread
+
+  std::vector<sweep_config_s> m_configs;
+  std::vector<cache_base_c*>  m_caches;     ///< one per configuration
+  int m_num_workers;                        ///< worker "w" runs configurations w, w + N, ...
+  int m_depth;                              ///< ring depth in blocks
+  int m_block_size;                         ///< records per block
+
+  block_ring_c<block_s> m_ring;             ///< every block goes to all workers
+};
+
+#endif // !__SWEEP_H__
@@ -0,0 +1,100 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "tag_match.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+uint64_t tag_match_scalar(const uint64_t* words, int n, uint64_t key, uint64_t mask) {
+  uint64_t hits = 0;
+  for (int way = 0; way < n; ++way) {
+    hits |= (uint64_t)((words[way] & mask) == key) << way;
+  }
+  return hits;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/**
+ * SSE2 has no 64-bit compare, so each pair of ways is compared as four
+ * 32-bit lanes and a lane pair counts as a match only if both halves match.
+ */
+__attribute__((target("sse2")))
+uint64_t tag_match_sse2(const uint64_t* words, int n, uint64_t key, uint64_t mask) {
+  const __m128i vkey  = _mm_set1_epi64x(key);
+  const __m128i vmask = _mm_set1_epi64x(mask);
+  uint64_t hits = 0;
+  int way = 0;
+  for (; way + 2 <= n; way += 2) {
+    __m128i w  = _mm_and_si128(_mm_loadu_si128((const __m128i*)(words + way)), vmask);
+    __m128i eq = _mm_cmpeq_epi32(w, vkey);
+    eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+    hits |= (uint64_t)_mm_movemask_pd(_mm_castsi128_pd(eq)) << way;
+  }
+  for (; way < n; ++way) {
+    hits |= (uint64_t)((words[way] & mask) == key) << way;
+  }
+  return hits;
+}
+
+__attribute__((target("avx2")))
+uint64_t tag_match_avx2(const uint64_t* words, int n, uint64_t key, uint64_t mask) {
+  const __m256i vkey  = _mm256_set1_epi64x(key);
+  const __m256i vmask = _mm256_set1_epi64x(mask);
+  uint64_t hits = 0;
+  int way = 0;
+  for (; way + 4 <= n; way += 4) {
+    __m256i w  = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(words + way)), vmask);
+    __m256i eq = _mm256_cmpeq_epi64(w, vkey);
+    hits |= (uint64_t)_mm256_movemask_pd(_mm256_castsi256_pd(eq)) << way;
+  }
+  for (; way < n; ++way) {
+    hits |= (uint64_t)((words[way] & mask) == key) << way;
+  }
+  return hits;
+}
+
+static tag_match_fn select_tag_match(const char** name) {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) { *name = "avx2"; return tag_match_avx2; }
+  if (__builtin_cpu_supports("sse2")) { *name = "sse2"; return tag_match_sse2; }
+  *name = "scalar";
+  return tag_match_scalar;
+}
+
+#else
+
+static tag_match_fn select_tag_match(const char** name) {
+  *name = "scalar";
+  return tag_match_scalar;
+}
+
+#endif
+
+static const char* s_kernel_name = nullptr;
+
+/**
+ * tag_match starts out pointing here, so a lookup from a static initializer
+ * that runs before this file's still picks the kernel.
+ */
+static uint64_t tag_match_resolve(const uint64_t* words, int n, uint64_t key, uint64_t mask) {
+  tag_match = select_tag_match(&s_kernel_name);
+  return tag_match(words, n, key, mask);
+}
+
+tag_match_fn tag_match = tag_match_resolve;
+
+/**
+ * Binds the kernel during static initialization, before main() can start a
+ * sweep or shard worker, so the worker threads only ever read tag_match.
+ */
+static struct tag_match_init_s {
+  tag_match_init_s() { tag_match_kernel_name(); }
+} s_tag_match_init;
+
+const char* tag_match_kernel_name() {
+  if (!s_kernel_name) tag_match = select_tag_match(&s_kernel_name);
+  return s_kernel_name;
+}
@@ -0,0 +1,31 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __TAG_MATCH_H__
+#define __TAG_MATCH_H__
+
+#include <cstdint>
+
+/**
+ * Way-parallel tag comparison for one cache set.
+ *
+ * Compares (words[way] & mask) against key for ways [0, n) and returns a
+ * bitmask with bit "way" set for every match.  n must not exceed 64.
+ *
+ * tag_match() is bound to the widest kernel the host CPU supports (AVX2,
+ * then SSE2, then the portable scalar loop) during static initialization,
+ * before any thread starts; after that it is only read.  The individual
+ * kernels are exported for benchmarking.
+ */
+typedef uint64_t (*tag_match_fn)(const uint64_t* words, int n, uint64_t key, uint64_t mask);
+
+extern tag_match_fn tag_match;
+const char* tag_match_kernel_name();
+
+uint64_t tag_match_scalar(const uint64_t* words, int n, uint64_t key, uint64_t mask);
+#if defined(__x86_64__) || defined(__i386__)
+uint64_t tag_match_sse2(const uint64_t* words, int n, uint64_t key, uint64_t mask);
+uint64_t tag_match_avx2(const uint64_t* words, int n, uint64_t key, uint64_t mask);
+#endif
+
+#endif // !__TAG_MATCH_H__
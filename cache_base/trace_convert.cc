@@ -0,0 +1,73 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "trace_reader.h"
+#include "trace_writer.h"
+
+#include <cstdio>
+#include <sys/stat.h>
+
+static long long file_size(const char* name) {
+  struct stat st;
+  return (stat(name, &st) == 0) ? (long long)st.st_size : -1;
+}
+
+/**
+ * Converts a text trace into the binary trace format, or a binary trace back
+ * into text.  The direction follows the format of the input.
+ */
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "[Usage]: %s <input trace> <output trace>\n"
+                    "  text input is written as a binary trace, binary input as text\n", argv[0]);
+    return -1;
+  }
+
+  trace_reader_c reader;
+  if (!reader.open(argv[1])) {
+    fprintf(stderr, "[Error]: cannot read %s\n", argv[1]);
+    return -1;
+  }
+
+  int type;
+  addr_t address;
+  unsigned long long num_records = 0;
+
+  if (reader.is_binary()) {
+    FILE* out = fopen(argv[2], "w");
+    if (!out) {
+      fprintf(stderr, "[Error]: cannot create %s\n", argv[2]);
+      return -1;
+    }
+    setvbuf(out, nullptr, _IOFBF, 1 << 20);
+    while (reader.next(&type, &address)) {
+      fprintf(out, "%d %lx\n", type, address);
+      num_records++;
+    }
+    if (fclose(out) != 0) {
+      fprintf(stderr, "[Error]: failed to write %s\n", argv[2]);
+      return -1;
+    }
+  } else {
+    trace_writer_c writer;
+    if (!writer.open(argv[2])) {
+      fprintf(stderr, "[Error]: cannot create %s\n", argv[2]);
+      return -1;
+    }
+    while (reader.next(&type, &address)) {
+      writer.write(type, address);
+    }
+    num_records = writer.get_num_records();
+    if (!writer.close()) {
+      fprintf(stderr, "[Error]: failed to write %s\n", argv[2]);
+      return -1;
+    }
+  }
+
+  long long in_size  = file_size(argv[1]);
+  long long out_size = file_size(argv[2]);
+  printf("%llu records: %lld -> %lld bytes", num_records, in_size, out_size);
+  if (in_size > 0 && out_size > 0) printf(" (%.2fx)", (double)in_size / out_size);
+  printf("\n");
+  return 0;
+}
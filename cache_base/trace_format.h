@@ -0,0 +1,68 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __TRACE_FORMAT_H__
+#define __TRACE_FORMAT_H__
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Binary trace format
+ *
+ *   header  : 8-byte magic "L4TRACE\0", uint32 version, uint32 reserved,
+ *             uint64 number of records (0 if unknown); little endian
+ *   records : varint((zigzag(addr - prev addr[type]) << 3) | type)
+ *
+ * Types 0-6 (the MEM_REQ_TYPE values) are stored inline, and each type is
+ * delta-encoded against the previous address of the same type, so the
+ * instruction stream and the data streams each stay small.  All delta bases
+ * start at 0.  Type field 7 is an escape for anything that does not fit: it
+ * is followed by varint(zigzag(type)) and the absolute address as 8 raw
+ * bytes; escaped records leave the delta bases alone.
+ */
+namespace trace_format {
+  const char     MAGIC[8]    = {'L', '4', 'T', 'R', 'A', 'C', 'E', '\0'};
+  const uint32_t VERSION     = 1;
+  const size_t   HEADER_SIZE = 24;
+
+  const int      TYPE_BITS   = 3;
+  const uint64_t TYPE_MASK   = (1 << TYPE_BITS) - 1;
+  const uint64_t ESCAPE      = TYPE_MASK;
+  const int      NUM_STREAMS = ESCAPE;       ///< one delta base per inline type
+  const uint64_t MAX_INLINE_DELTA = UINT64_MAX >> TYPE_BITS;  ///< largest zigzag delta stored inline
+
+  inline uint64_t zigzag(int64_t value)   { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+  inline int64_t  unzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+  /// writes "value" as a LEB128 varint at "out"; returns the number of bytes written (at most 10)
+  inline int put_varint(uint8_t* out, uint64_t value) {
+    int len = 0;
+    while (value >= 0x80) {
+      out[len++] = (uint8_t)value | 0x80;
+      value >>= 7;
+    }
+    out[len++] = (uint8_t)value;
+    return len;
+  }
+
+  /// reads a varint from [cur, end) and advances cur; returns false if it is truncated
+  inline bool get_varint(const uint8_t*& cur, const uint8_t* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; cur < end && shift < 64; shift += 7) {
+      uint8_t byte = *cur++;
+      result |= (uint64_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  inline bool is_binary(const char* data, size_t size) {
+    return size >= HEADER_SIZE && memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+  }
+}
+
+#endif // !__TRACE_FORMAT_H__
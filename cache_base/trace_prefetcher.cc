@@ -0,0 +1,151 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "trace_prefetcher.h"
+
+#include <iostream>
+
+trace_prefetcher_c::trace_prefetcher_c(int depth, int block_size)
+    : m_depth(depth < 0 ? 0 : depth), m_block_size(block_size),
+      m_stop(false), m_seq(0), m_block(nullptr), m_pos(0), m_len(0), m_holding(false),
+      m_num_blocks(0), m_num_consumer_waits(0), m_num_producer_waits(0) {
+  m_ring.init(m_depth ? m_depth : 1);
+  for (int ii = 0; ii < m_ring.get_depth(); ++ii) {
+    m_ring.get(ii).m_rec.resize(m_block_size);
+    m_ring.get(ii).m_len = 0;
+  }
+}
+
+trace_prefetcher_c::~trace_prefetcher_c() {
+  close();
+}
+
+bool trace_prefetcher_c::open(const std::string& fname, const trace_pos_s* start) {
+  close();
+  if (!m_reader.open(fname)) return false;
+  if (start && !m_reader.seek(*start)) {
+    m_reader.close();
+    return false;
+  }
+  m_fname = fname;
+  m_reader.get_pos(&m_block_start);
+
+  m_ring.reset();
+  m_stop = false;
+  m_seq = 0;
+  m_block = nullptr;
+  m_pos = m_len = 0;
+  m_holding = false;
+
+  if (m_depth) m_thread = std::thread(&trace_prefetcher_c::produce, this);
+  return true;
+}
+
+void trace_prefetcher_c::close() {
+  if (m_thread.joinable()) {
+    m_stop.store(true, std::memory_order_release);
+    m_thread.join();
+  }
+  m_reader.close();
+  m_block = nullptr;
+  m_pos = m_len = 0;
+  m_holding = false;
+}
+
+size_t trace_prefetcher_c::fill(block_s& block) {
+  m_reader.get_pos(&block.m_start);
+  size_t len = 0;
+  int type;
+  addr_t address;
+  while (len < (size_t)m_block_size && m_reader.next(&type, &address)) {
+    block.m_rec[len].m_type = type;
+    block.m_rec[len].m_addr = address;
+    ++len;
+  }
+  block.m_len = len;
+  return len;
+}
+
+/**
+ * Reader thread: fills the ring until the trace ends.  A full ring means the
+ * simulator is the bottleneck, so the thread yields until a slot frees up.
+ */
+void trace_prefetcher_c::produce() {
+  while (!m_stop.load(std::memory_order_acquire)) {
+    if (m_ring.is_full()) {
+      m_num_producer_waits.fetch_add(1, std::memory_order_relaxed);
+      while (m_ring.is_full() && !m_stop.load(std::memory_order_acquire))
+        std::this_thread::yield();
+      continue;
+    }
+
+    size_t len = fill(m_ring.get(m_ring.get_tail()));
+    if (len) m_ring.publish();
+    if (len < (size_t)m_block_size) break;
+  }
+  m_ring.finish();
+}
+
+/**
+ * Releases the block just consumed and waits for the next one.
+ */
+bool trace_prefetcher_c::next_block() {
+  if (!m_depth) {
+    block_s& block = m_ring.get(0);
+    m_block = block.m_rec.data();
+    m_pos   = 0;
+    m_len   = fill(block);
+    m_block_start = block.m_start;
+    if (m_len) ++m_num_blocks;
+    return m_len != 0;
+  }
+
+  if (m_holding) {
+    m_ring.release(m_seq++);
+    m_holding = false;
+  }
+
+  if (!m_ring.is_published(m_seq)) {
+    ++m_num_consumer_waits;
+    if (!m_ring.wait(m_seq)) return false;
+  }
+
+  const block_s& block = m_ring.get(m_seq);
+  m_block   = block.m_rec.data();
+  m_pos     = 0;
+  m_len     = block.m_len;
+  m_block_start = block.m_start;
+  m_holding = true;
+  ++m_num_blocks;
+  return true;
+}
+
+/**
+ * The reader runs ahead, so decode the records consumed from the current
+ * block again, from the position the block started at.
+ */
+bool trace_prefetcher_c::get_pos(trace_pos_s* pos) const {
+  trace_reader_c reader;
+  if (!reader.open(m_fname) || !reader.seek(m_block_start)) return false;
+
+  int type;
+  addr_t address;
+  for (size_t ii = 0; ii < m_pos; ++ii) reader.next(&type, &address);
+  reader.get_pos(pos);
+  return true;
+}
+
+void trace_prefetcher_c::print_stats() {
+  if (!m_depth) return;
+
+  std::cout << "------------------------------" << std::endl;
+  std::cout << "Trace Prefetch Stats" << std::endl;
+  std::cout << "------------------------------" << std::endl;
+  std::cout << "ring depth (blocks x records): " << m_depth << " x " << m_block_size << std::endl;
+  std::cout << "number of blocks: " << m_num_blocks << std::endl;
+
+  // the waits change from run to run, so they stay out of the simulation output
+  std::cerr << "number of blocks the simulator waited for: " << m_num_consumer_waits
+            << " (" << (m_num_blocks ? 100.0 * m_num_consumer_waits / m_num_blocks : 0.0) << " %)" << std::endl;
+  std::cerr << "number of reader stalls on a full ring: " << m_num_producer_waits << std::endl;
+}
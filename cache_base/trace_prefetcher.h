@@ -0,0 +1,106 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __TRACE_PREFETCHER_H__
+#define __TRACE_PREFETCHER_H__
+
+#include "block_ring.h"
+#include "trace_reader.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// one decoded trace record
+struct trace_record_s {
+  addr_t m_addr;
+  int    m_type;
+};
+
+/**
+ * @class trace_prefetcher_c
+ *
+ * Decodes a trace ahead of the simulator.  A background thread runs the
+ * trace_reader_c and publishes blocks of decoded records into a lock-free
+ * single-producer/single-consumer ring of "depth" blocks; next() hands them
+ * out without system calls or parsing.
+ *
+ * The ring counts how many blocks the consumer had to wait for (the run is
+ * I/O- or decode-bound) and how many times the reader found the ring full
+ * (the run is simulation-bound).
+ *
+ * With depth 0 no thread is started and blocks are decoded on demand in the
+ * caller's thread.
+ *
+ * Every block remembers the reader position it was decoded from, so the
+ * position of the next record to hand out can be recovered (get_pos) and a
+ * later run can open the trace there.
+ */
+class trace_prefetcher_c {
+public:
+  trace_prefetcher_c(int depth, int block_size = 4096);
+  ~trace_prefetcher_c();
+
+  /// returns false if the trace cannot be opened or "start" is not in it
+  bool open(const std::string& fname, const trace_pos_s* start = nullptr);
+  void close();
+
+  /// returns the next record; false at the end of the trace
+  bool next(int* type, addr_t* address) {
+    if (!peek(type, address)) return false;
+    ++m_pos;
+    return true;
+  }
+
+  /// returns the next record without consuming it; false at the end of the trace
+  bool peek(int* type, addr_t* address) {
+    if (m_pos == m_len && !next_block()) return false;
+    const trace_record_s& rec = m_block[m_pos];
+    *type    = rec.m_type;
+    *address = rec.m_addr;
+    return true;
+  }
+
+  /// reader position of the next record next() returns; false if the trace cannot be reopened
+  bool get_pos(trace_pos_s* pos) const;
+
+  void print_stats();                       ///< ring depth and blocks; the wait counters go to stderr
+
+private:
+  trace_prefetcher_c(const trace_prefetcher_c&);             // not copyable
+  trace_prefetcher_c& operator=(const trace_prefetcher_c&);
+
+  struct block_s {
+    std::vector<trace_record_s> m_rec;
+    size_t m_len;
+    trace_pos_s m_start;                    ///< reader position of the first record
+  };
+
+  bool   next_block();                      ///< moves to the next filled block
+  size_t fill(block_s& block);              ///< decodes up to one block of records
+  void   produce();                         ///< background reader thread
+
+  trace_reader_c m_reader;
+  std::string m_fname;                      ///< the trace (get_pos decodes into a block again)
+  int    m_depth;                           ///< ring depth in blocks (0: no thread)
+  int    m_block_size;                      ///< records per block
+
+  block_ring_c<block_s> m_ring;             ///< decoded blocks (one block if depth is 0)
+  std::atomic<bool> m_stop;                 ///< asks the reader to quit early
+  std::thread m_thread;
+
+  uint64_t m_seq;                           ///< ring block being consumed
+  const trace_record_s* m_block;            ///< block being consumed
+  size_t m_pos;                             ///< next record in m_block
+  size_t m_len;                             ///< records in m_block
+  trace_pos_s m_block_start;                ///< reader position of m_block[0]
+  bool   m_holding;                         ///< m_block is a ring slot still owned by the consumer
+
+  uint64_t m_num_blocks;                    ///< blocks consumed
+  uint64_t m_num_consumer_waits;            ///< blocks the consumer had to wait for
+  std::atomic<uint64_t> m_num_producer_waits;  ///< times the reader found the ring full
+};
+
+#endif // !__TRACE_PREFETCHER_H__
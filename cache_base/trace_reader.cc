@@ -0,0 +1,215 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "trace_reader.h"
+#include "trace_format.h"
+
+#include <cstdio>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Value of each byte as a hex digit, or -1.  Decimal digits share the table
+ * (their value is below 10).
+ */
+struct hex_table_s {
+  int8_t value[256];
+
+  hex_table_s() {
+    for (int ii = 0; ii < 256; ++ii) value[ii] = -1;
+    for (int ii = 0; ii < 10; ++ii) value['0' + ii] = ii;
+    for (int ii = 0; ii < 6; ++ii) {
+      value['a' + ii] = 10 + ii;
+      value['A' + ii] = 10 + ii;
+    }
+  }
+};
+
+static const hex_table_s s_hex;
+
+trace_reader_c::trace_reader_c()
+    : m_begin(nullptr), m_cur(nullptr), m_end(nullptr), m_binary(false),
+      m_map(nullptr), m_map_size(0) {
+  memset(m_prev_addr, 0, sizeof(m_prev_addr));
+}
+
+trace_reader_c::~trace_reader_c() {
+  close();
+}
+
+/**
+ * Maps the trace file into memory.  Falls back to reading the whole input if
+ * the file is not a regular file or mmap fails.
+ */
+bool trace_reader_c::open(const std::string& fname) {
+  close();
+
+  int fd = ::open(fname.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      madvise(map, st.st_size, MADV_SEQUENTIAL);
+      m_map      = map;
+      m_map_size = st.st_size;
+      m_cur      = static_cast<const char*>(map);
+      m_end      = m_cur + m_map_size;
+      ::close(fd);
+      return start();
+    }
+  }
+
+  char chunk[1 << 16];
+  ssize_t len;
+  while ((len = ::read(fd, chunk, sizeof(chunk))) > 0) {
+    m_buffer.insert(m_buffer.end(), chunk, chunk + len);
+  }
+  ::close(fd);
+  m_cur = m_buffer.data();
+  m_end = m_cur + m_buffer.size();
+  return start();
+}
+
+/**
+ * Skips and checks the header of a binary trace; text traces start decoding
+ * at the first byte.
+ */
+bool trace_reader_c::start() {
+  m_begin     = m_cur;
+  m_binary    = trace_format::is_binary(m_cur, m_end - m_cur);
+  memset(m_prev_addr, 0, sizeof(m_prev_addr));
+  if (!m_binary) return true;
+
+  uint32_t version;
+  memcpy(&version, m_cur + sizeof(trace_format::MAGIC), sizeof(version));
+  if (version != trace_format::VERSION) {
+    fprintf(stderr, "[Error]: unsupported binary trace version %u\n", version);
+    close();
+    return false;
+  }
+  m_cur += trace_format::HEADER_SIZE;
+  return true;
+}
+
+void trace_reader_c::close() {
+  if (m_map) munmap(m_map, m_map_size);
+  m_map = nullptr;
+  m_map_size = 0;
+  m_buffer.clear();
+  m_begin = m_cur = m_end = nullptr;
+  m_binary = false;
+}
+
+void trace_reader_c::get_pos(trace_pos_s* pos) const {
+  pos->m_offset = m_cur - m_begin;
+  memcpy(pos->m_prev_addr, m_prev_addr, sizeof(m_prev_addr));
+}
+
+/**
+ * Jumps to a position taken with get_pos() on the same trace.  Text records
+ * have no state, and binary records only need the delta bases back.
+ */
+bool trace_reader_c::seek(const trace_pos_s& pos) {
+  if (!m_begin || pos.m_offset > (uint64_t)(m_end - m_begin)) return false;
+  if (m_binary && pos.m_offset < trace_format::HEADER_SIZE) return false;
+
+  m_cur = m_begin + pos.m_offset;
+  memcpy(m_prev_addr, pos.m_prev_addr, sizeof(m_prev_addr));
+  return true;
+}
+
+/**
+ * Decodes one "<type> <address>" line: a decimal type, blanks, and a hex
+ * address with an optional 0x prefix (the same input sscanf("%d %lx")
+ * accepts).  Lines that do not match are skipped.
+ */
+bool trace_reader_c::next_text(int* type, addr_t* address) {
+  const int8_t* hex = s_hex.value;
+  const char*   cur = m_cur;
+  const char*   end = m_end;
+
+  while (cur < end) {
+    // skip leading blanks and empty lines
+    while (cur < end && (*cur == ' ' || *cur == '\t' || *cur == '\r' || *cur == '\n')) ++cur;
+    if (cur == end) break;
+
+    // decimal type
+    bool negative = (*cur == '-');
+    cur += negative;
+    const char* digits = cur;
+    int value = 0;
+    int8_t d;
+    while (cur < end && (d = hex[(uint8_t)*cur]) >= 0 && d < 10) {
+      value = value * 10 + d;
+      ++cur;
+    }
+    bool ok = (cur != digits);
+
+    // separator
+    const char* sep = cur;
+    while (cur < end && (*cur == ' ' || *cur == '\t')) ++cur;
+    ok = ok && (cur != sep);
+
+    // hex address
+    if (end - cur > 2 && cur[0] == '0' && (cur[1] | 0x20) == 'x' && hex[(uint8_t)cur[2]] >= 0) cur += 2;
+    digits = cur;
+    addr_t addr = 0;
+    while (cur < end && (d = hex[(uint8_t)*cur]) >= 0) {
+      addr = (addr << 4) | (addr_t)d;
+      ++cur;
+    }
+    ok = ok && (cur != digits);
+
+    // drop the rest of the line
+    while (cur < end && *cur != '\n') ++cur;
+
+    if (ok) {
+      m_cur    = cur;
+      *type    = negative ? -value : value;
+      *address = addr;
+      return true;
+    }
+  }
+
+  m_cur = cur;
+  return false;
+}
+
+/**
+ * Decodes one binary record (see trace_format.h).  A truncated record at the
+ * end of the file ends the trace.
+ */
+bool trace_reader_c::next_binary(int* type, addr_t* address) {
+  const uint8_t* cur = reinterpret_cast<const uint8_t*>(m_cur);
+  const uint8_t* end = reinterpret_cast<const uint8_t*>(m_end);
+
+  uint64_t value;
+  if (!trace_format::get_varint(cur, end, &value)) {
+    m_cur = m_end;
+    return false;
+  }
+
+  uint64_t field = value & trace_format::TYPE_MASK;
+  if (field != trace_format::ESCAPE) {
+    m_prev_addr[field] += (addr_t)trace_format::unzigzag(value >> trace_format::TYPE_BITS);
+    *type    = (int)field;
+    *address = m_prev_addr[field];
+  } else {
+    uint64_t escaped;
+    if (!trace_format::get_varint(cur, end, &escaped) || end - cur < 8) {
+      m_cur = m_end;
+      return false;
+    }
+    memcpy(address, cur, sizeof(*address));
+    cur += sizeof(*address);
+    *type = (int)trace_format::unzigzag(escaped);
+  }
+
+  m_cur = reinterpret_cast<const char*>(cur);
+  return true;
+}
@@ -0,0 +1,73 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __TRACE_READER_H__
+#define __TRACE_READER_H__
+
+#include "trace_format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using addr_t = uint64_t;
+
+/// a point in a trace to resume decoding from (see trace_reader_c::seek)
+struct trace_pos_s {
+  uint64_t m_offset;                                ///< byte offset of the next record
+  addr_t   m_prev_addr[trace_format::NUM_STREAMS];  ///< binary delta bases at that point
+};
+
+/**
+ * @class trace_reader_c
+ *
+ * Reads a trace straight out of a memory-mapped file.  Records are decoded
+ * in place, so there is no per-line allocation or sscanf.  Inputs that
+ * cannot be mapped (e.g., pipes) are read into a buffer once and decoded the
+ * same way.
+ *
+ * Both trace formats are accepted and detected from the file header:
+ * - text: "<type> <hex address>" lines.  Blank and malformed lines are
+ *   skipped, and the last record is returned whether or not the file ends
+ *   with a newline.
+ * - binary: see trace_format.h.
+ */
+class trace_reader_c {
+public:
+  trace_reader_c();
+  ~trace_reader_c();
+
+  bool open(const std::string& fname);      ///< returns false if the trace cannot be opened
+  void close();
+
+  /// decodes the next record; returns false at the end of the trace
+  bool next(int* type, addr_t* address) {
+    return m_binary ? next_binary(type, address) : next_text(type, address);
+  }
+
+  bool is_binary() const { return m_binary; }
+
+  void get_pos(trace_pos_s* pos) const;     ///< position of the next record
+  bool seek(const trace_pos_s& pos);        ///< resumes at "pos"; false if it is past the end
+
+private:
+  bool start();                                      ///< detects the format of the loaded data
+  bool next_text(int* type, addr_t* address);
+  bool next_binary(int* type, addr_t* address);
+
+  trace_reader_c(const trace_reader_c&);             // not copyable
+  trace_reader_c& operator=(const trace_reader_c&);
+
+  const char* m_begin;            ///< first byte of the file
+  const char* m_cur;              ///< next byte to decode
+  const char* m_end;              ///< end of the trace data
+  bool        m_binary;           ///< binary trace format
+  addr_t      m_prev_addr[trace_format::NUM_STREAMS];  ///< per-type delta bases for binary records
+
+  void*  m_map;                   ///< mmap'ed file (nullptr if buffered)
+  size_t m_map_size;              ///< length of the mapping
+  std::vector<char> m_buffer;     ///< fallback storage for unmappable inputs
+};
+
+#endif // !__TRACE_READER_H__
@@ -0,0 +1,74 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "trace_writer.h"
+#include "trace_format.h"
+
+static const size_t BUFFER_SIZE = 1 << 20;
+static const size_t MAX_RECORD  = 2 * 10 + 8;   // escape: two varints plus a raw address
+
+trace_writer_c::trace_writer_c()
+    : m_file(nullptr), m_used(0), m_num_records(0), m_error(false) {
+  memset(m_prev_addr, 0, sizeof(m_prev_addr));
+}
+
+trace_writer_c::~trace_writer_c() {
+  close();
+}
+
+bool trace_writer_c::open(const std::string& fname) {
+  close();
+  m_file = fopen(fname.c_str(), "wb");
+  if (!m_file) return false;
+
+  m_buffer.resize(BUFFER_SIZE);
+  m_used = 0;
+  memset(m_prev_addr, 0, sizeof(m_prev_addr));
+  m_num_records = 0;
+  m_error = false;
+
+  // the record count is patched in by close()
+  uint8_t header[trace_format::HEADER_SIZE] = {0};
+  memcpy(header, trace_format::MAGIC, sizeof(trace_format::MAGIC));
+  memcpy(header + sizeof(trace_format::MAGIC), &trace_format::VERSION, sizeof(uint32_t));
+  memcpy(&m_buffer[0], header, sizeof(header));
+  m_used = sizeof(header);
+  return true;
+}
+
+void trace_writer_c::write(int type, addr_t address) {
+  if (m_used + MAX_RECORD > m_buffer.size()) flush();
+
+  uint8_t* out = &m_buffer[m_used];
+  bool inline_type = (type >= 0 && type < trace_format::NUM_STREAMS);
+  uint64_t delta = inline_type ? trace_format::zigzag((int64_t)(address - m_prev_addr[type])) : 0;
+  if (inline_type && delta <= trace_format::MAX_INLINE_DELTA) {
+    m_used += trace_format::put_varint(out, (delta << trace_format::TYPE_BITS) | (uint64_t)type);
+    m_prev_addr[type] = address;
+  } else {
+    int len = trace_format::put_varint(out, trace_format::ESCAPE);
+    len += trace_format::put_varint(out + len, trace_format::zigzag(type));
+    memcpy(out + len, &address, sizeof(address));
+    m_used += len + sizeof(address);
+  }
+
+  m_num_records++;
+}
+
+void trace_writer_c::flush() {
+  if (m_used && fwrite(m_buffer.data(), 1, m_used, m_file) != m_used) m_error = true;
+  m_used = 0;
+}
+
+bool trace_writer_c::close() {
+  if (!m_file) return !m_error;
+
+  flush();
+  // fill in the record count; outputs that cannot seek keep 0 (unknown)
+  if (fseek(m_file, sizeof(trace_format::MAGIC) + 2 * sizeof(uint32_t), SEEK_SET) == 0) {
+    if (fwrite(&m_num_records, sizeof(m_num_records), 1, m_file) != 1) m_error = true;
+  }
+  if (fclose(m_file) != 0) m_error = true;
+  m_file = nullptr;
+  return !m_error;
+}
@@ -0,0 +1,48 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __TRACE_WRITER_H__
+#define __TRACE_WRITER_H__
+
+#include "trace_format.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using addr_t = uint64_t;
+
+/**
+ * @class trace_writer_c
+ *
+ * Writes a binary trace (see trace_format.h).  Records are encoded into a
+ * buffer and flushed in large blocks; close() fills in the record count in
+ * the header when the output is seekable.
+ */
+class trace_writer_c {
+public:
+  trace_writer_c();
+  ~trace_writer_c();
+
+  bool open(const std::string& fname);      ///< returns false if the output cannot be created
+  void write(int type, addr_t address);
+  bool close();                             ///< returns false if any write failed
+
+  uint64_t get_num_records() const { return m_num_records; }
+
+private:
+  trace_writer_c(const trace_writer_c&);             // not copyable
+  trace_writer_c& operator=(const trace_writer_c&);
+
+  void flush();
+
+  FILE*    m_file;
+  std::vector<uint8_t> m_buffer;  ///< encoded records not yet written
+  size_t   m_used;                ///< bytes used in m_buffer
+  addr_t   m_prev_addr[trace_format::NUM_STREAMS];  ///< per-type delta bases
+  uint64_t m_num_records;
+  bool     m_error;
+};
+
+#endif // !__TRACE_WRITER_H__
@@ -4,7 +4,55 @@
 #include <cassert>
 #include <vector>
 
-config_c::config_c(const std::string& fname) {
+// defaults for the optional keys; the cache/memory keys must be in the file
+config_c::config_c() {
+  l1i_replacement = "lru";
+  l1d_replacement = "lru";
+  l2_replacement = "lru";
+  replacement_seed = 1;
+  l1i_set_sampling = 1;
+  l1d_set_sampling = 1;
+  l2_set_sampling = 1;
+  l2_sparse = 0;
+  dram_model = "simple";
+  dram_channels = 1;
+  dram_ranks = 1;
+  dram_banks = 8;
+  dram_row_size = 8192;
+  dram_address_map = "row:rank:bank:channel:column";
+  dram_page_policy = "open";
+  dram_trcd = 40;
+  dram_tcas = 40;
+  dram_trp = 40;
+  dram_tburst = 8;
+  dram_queue_size = 32;
+  mshr_entries = 0;
+  mshr_targets = 0;
+  l1i_prefetcher = "none";
+  l1d_prefetcher = "none";
+  l2_prefetcher = "none";
+  prefetch_degree = 2;
+  prefetch_distance = 1;
+  prefetch_throttle = 0;
+  coherence_latency = 20;
+  multiprogram = 0;
+  l2_partition = "none";
+  l2_partition_ways = "none";
+  ucp_interval = 1000000;
+  l2_inclusion = "inclusive";
+  l2_inclusion_set = 0;
+  trace_ring_depth = 0;
+  trace_stats = 0;
+  cycle_skip = 1;
+  sample_interval = 0;
+  sample_warmup = 2000;
+  sample_unit = 1000;
+  checkpoint_insts = 0;
+  checkpoint_save = "none";
+  checkpoint_load = "none";
+}
+
+config_c::config_c(const std::string& fname) : config_c() {
   parse(fname);
 }
 
@@ -57,10 +105,97 @@ void config_c::parse(const std::string& fname) {
       l2_line_size = atoi(tokens[1].c_str());
     } else if (tokens[0] == "l2_latency") {
       l2_latency = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "l1i_replacement") {
+      l1i_replacement = tokens[1];
+    } else if (tokens[0] == "l1d_replacement") {
+      l1d_replacement = tokens[1];
+    } else if (tokens[0] == "l2_replacement") {
+      l2_replacement = tokens[1];
+    } else if (tokens[0] == "replacement_seed") {
+      replacement_seed = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "l1i_set_sampling") {
+      l1i_set_sampling = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "l1d_set_sampling") {
+      l1d_set_sampling = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "l2_set_sampling") {
+      l2_set_sampling = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "l2_sparse") {
+      l2_sparse = atoi(tokens[1].c_str());
     } else if (tokens[0] == "memory_latency") {
       memory_latency = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "dram_model") {
+      dram_model = tokens[1];
+    } else if (tokens[0] == "dram_channels") {
+      dram_channels = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "dram_ranks") {
+      dram_ranks = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "dram_banks") {
+      dram_banks = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "dram_row_size") {
+      dram_row_size = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "dram_address_map") {
+      dram_address_map = tokens[1];
+    } else if (tokens[0] == "dram_page_policy") {
+      dram_page_policy = tokens[1];
+    } else if (tokens[0] == "dram_trcd") {
+      dram_trcd = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "dram_tcas") {
+      dram_tcas = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "dram_trp") {
+      dram_trp = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "dram_tburst") {
+      dram_tburst = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "dram_queue_size") {
+      dram_queue_size = atoi(tokens[1].c_str());
     } else if (tokens[0] == "single_request") {
       single_request = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "mshr_entries") {
+      mshr_entries = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "mshr_targets") {
+      mshr_targets = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "l1i_prefetcher") {
+      l1i_prefetcher = tokens[1];
+    } else if (tokens[0] == "l1d_prefetcher") {
+      l1d_prefetcher = tokens[1];
+    } else if (tokens[0] == "l2_prefetcher") {
+      l2_prefetcher = tokens[1];
+    } else if (tokens[0] == "prefetch_degree") {
+      prefetch_degree = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "prefetch_distance") {
+      prefetch_distance = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "prefetch_throttle") {
+      prefetch_throttle = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "coherence_latency") {
+      coherence_latency = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "multiprogram") {
+      multiprogram = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "l2_partition") {
+      l2_partition = tokens[1];
+    } else if (tokens[0] == "l2_partition_ways") {
+      l2_partition_ways = tokens[1];
+    } else if (tokens[0] == "ucp_interval") {
+      ucp_interval = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "l2_inclusion") {
+      l2_inclusion = tokens[1];
+      l2_inclusion_set = 1;
+    } else if (tokens[0] == "trace_ring_depth") {
+      trace_ring_depth = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "trace_stats") {
+      trace_stats = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "cycle_skip") {
+      cycle_skip = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "sample_interval") {
+      sample_interval = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "sample_warmup") {
+      sample_warmup = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "sample_unit") {
+      sample_unit = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "checkpoint_insts") {
+      checkpoint_insts = atoi(tokens[1].c_str());
+    } else if (tokens[0] == "checkpoint_save") {
+      checkpoint_save = tokens[1];
+    } else if (tokens[0] == "checkpoint_load") {
+      checkpoint_load = tokens[1];
     }
   }
   file.close();
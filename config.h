@@ -5,7 +5,7 @@
 
 class config_c {
 public:
-  config_c() {}
+  config_c();
   config_c(const std::string& fname);
 
   void parse(const std::string& fname);
@@ -27,8 +27,60 @@ public:
   int get_l2_line_size() const {return l2_line_size;}
   int get_l2_latency() const {return l2_latency;}
 
+  const std::string& get_l1i_replacement() const {return l1i_replacement;}
+  const std::string& get_l1d_replacement() const {return l1d_replacement;}
+  const std::string& get_l2_replacement() const {return l2_replacement;}
+  int get_replacement_seed() const {return replacement_seed;}
+
+  int get_l1i_set_sampling() const {return l1i_set_sampling;}
+  int get_l1d_set_sampling() const {return l1d_set_sampling;}
+  int get_l2_set_sampling() const {return l2_set_sampling;}
+  int is_l2_sparse() const {return l2_sparse;}
+
   int get_memory_latency() const {return memory_latency;} 
 
+  const std::string& get_dram_model() const {return dram_model;}
+  int get_dram_channels() const {return dram_channels;}
+  int get_dram_ranks() const {return dram_ranks;}
+  int get_dram_banks() const {return dram_banks;}
+  int get_dram_row_size() const {return dram_row_size;}
+  const std::string& get_dram_address_map() const {return dram_address_map;}
+  const std::string& get_dram_page_policy() const {return dram_page_policy;}
+  int get_dram_trcd() const {return dram_trcd;}
+  int get_dram_tcas() const {return dram_tcas;}
+  int get_dram_trp() const {return dram_trp;}
+  int get_dram_tburst() const {return dram_tburst;}
+  int get_dram_queue_size() const {return dram_queue_size;}
+
+  int get_mshr_entries() const {return mshr_entries;}
+  int get_mshr_targets() const {return mshr_targets;}
+
+  const std::string& get_l1i_prefetcher() const {return l1i_prefetcher;}
+  const std::string& get_l1d_prefetcher() const {return l1d_prefetcher;}
+  const std::string& get_l2_prefetcher() const {return l2_prefetcher;}
+  int get_prefetch_degree() const {return prefetch_degree;}
+  int get_prefetch_distance() const {return prefetch_distance;}
+  int is_prefetch_throttle() const {return prefetch_throttle;}
+  int get_coherence_latency() const {return coherence_latency;}
+  int is_multiprogram() const {return multiprogram;}
+  const std::string& get_l2_partition() const {return l2_partition;}
+  const std::string& get_l2_partition_ways() const {return l2_partition_ways;}
+  int get_ucp_interval() const {return ucp_interval;}
+  const std::string& get_l2_inclusion() const {return l2_inclusion;}
+  int is_l2_inclusion_set() const {return l2_inclusion_set;}
+
+  int get_trace_ring_depth() const {return trace_ring_depth;}
+  int is_trace_stats() const {return trace_stats;}
+  int is_cycle_skip() const {return cycle_skip;}
+
+  int get_sample_interval() const {return sample_interval;}
+  int get_sample_warmup() const {return sample_warmup;}
+  int get_sample_unit() const {return sample_unit;}
+
+  int get_checkpoint_insts() const {return checkpoint_insts;}
+  const std::string& get_checkpoint_save() const {return checkpoint_save;}
+  const std::string& get_checkpoint_load() const {return checkpoint_load;}
+
 private:
   int mem_hierarchy;
   int single_request;
@@ -48,7 +100,59 @@ private:
   int l2_line_size;
   int l2_latency;
 
+  std::string l1i_replacement;    // replacement policy names (see parse_repl_policy)
+  std::string l1d_replacement;
+  std::string l2_replacement;
+  int replacement_seed;           // seed for random replacement and BRRIP
+
+  int l1i_set_sampling;           // simulate ~1 in this many sets (1: all sets)
+  int l1d_set_sampling;
+  int l2_set_sampling;
+  int l2_sparse;                  // allocate the L2 sets on first touch (huge caches)
+
   int memory_latency;
+
+  std::string dram_model;         // "simple" (memory_latency for every request) or "banked"
+  int dram_channels;              // banked DRAM geometry (powers of two)
+  int dram_ranks;                 // per channel
+  int dram_banks;                 // per rank
+  int dram_row_size;              // bytes per row
+  std::string dram_address_map;   // fields from most to least significant, row first
+  std::string dram_page_policy;   // "open" or "closed"
+  int dram_trcd;                  // timings in cycles
+  int dram_tcas;
+  int dram_trp;
+  int dram_tburst;
+  int dram_queue_size;            // requests per channel the scheduler picks from (0: all)
+
+  int mshr_entries;       // MSHR entries per cache (0: no MSHRs)
+  int mshr_targets;       // requests per MSHR entry, primary included (0: no limit)
+
+  std::string l1i_prefetcher;     // prefetcher names (see parse_prefetcher)
+  std::string l1d_prefetcher;
+  std::string l2_prefetcher;
+  int prefetch_degree;            // lines per prefetch trigger
+  int prefetch_distance;          // lines (or strides) ahead of the trigger
+  int prefetch_throttle;          // adjust degree/distance from accuracy feedback (0: fixed)
+  int coherence_latency;          // cycles an invalidation/downgrade of another core's L1 adds
+  int multiprogram;               // traces are independent programs (separate address spaces)
+  std::string l2_partition;       // way partitioning of the shared L2 (see parse_partition)
+  std::string l2_partition_ways;  // static: ways per core, e.g. "12,4" ("none": equal split)
+  int ucp_interval;               // cycles between UCP repartitioning decisions
+  std::string l2_inclusion;       // L2 toward the L1s (see parse_inclusion)
+  int l2_inclusion_set;           // l2_inclusion is in the file (the L2 reports its inclusion stats)
+
+  int trace_ring_depth;   // blocks decoded ahead by the trace reader thread (0: no thread)
+  int trace_stats;        // print the trace reader stats (0: leave them out)
+  int cycle_skip;         // jump over idle cycles while the core is stalled (0: tick every cycle)
+
+  int sample_interval;    // instructions per sampling period (0: time the whole trace)
+  int sample_warmup;      // detailed warm-up instructions before each measured unit
+  int sample_unit;        // measured instructions per sampling unit
+
+  int checkpoint_insts;         // instructions to warm before writing checkpoint_save
+  std::string checkpoint_save;  // checkpoint to write ("none": no checkpoint)
+  std::string checkpoint_load;  // checkpoint to start from ("none": cold caches)
 };
 
 #endif // !__CONFIG_H__
@@ -3,21 +3,36 @@
 
 #include "core.h"
 #include "memory_system/memory_hierarchy.h"
+#include "cache_base/trace_prefetcher.h"
+#include "atom/running_stat.h"
 
-#include <fstream>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <algorithm>
 
 // constructor
-core_c::core_c(memory_hierarchy_c* mm) {
+core_c::core_c(memory_hierarchy_c* mm, int core_id) {
   m_mm = mm;
   m_cycle = 0;
 
+  m_core_id = core_id;
+  m_trace = nullptr;
+  m_trace_done = false;
+  m_finished = false;
+
   m_num_insts = 0;
   m_num_mem_insts = 0;
 }
 
 // destructor
 core_c::~core_c() {
+  delete m_trace;
+}
+
+// trace records the core issues (others only take a cycle)
+static bool is_core_req(int type) {
+  return type == REQ_IFETCH || type == REQ_DFETCH || type == REQ_DSTORE;
 }
 
 /**
@@ -25,46 +40,388 @@ core_c::~core_c() {
  * @param filename - name of the trace file
  */
 void core_c::run_sim(std::string filename) {
-  std::ifstream trace_file(filename);
+  const config_c& cfg = m_mm->m_config;
+  trace_prefetcher_c trace(cfg.get_trace_ring_depth());
 
-  if (!trace_file.is_open()) 
-    return; 
+  // a checkpoint replaces the trace prefix it was warmed on
+  checkpoint_s start = checkpoint_s();
+  const bool restore = (cfg.get_checkpoint_load() != "none");
+  if (restore && !m_mm->load_checkpoint(cfg.get_checkpoint_load(), &start))
+    exit(1);
 
-  std::string line;
-  addr_t address;
-  int type;
+  if (!trace.open(filename, restore ? &start.m_trace_pos : nullptr)) {
+    if (!restore) return;
+    fprintf(stderr, "[Error]: checkpoint %s does not fit trace %s\n",
+            cfg.get_checkpoint_load().c_str(), filename.c_str());
+    exit(1);
+  }
 
-  while (true) {
-    if (!m_mm->m_config.is_single_request() || m_mm->get_num_in_flight_reqs() == 0) {
-      std::getline(trace_file, line);
-      if (trace_file.eof()) break;
+  if (cfg.get_checkpoint_save() != "none")
+    make_checkpoint(trace, start);
 
-      std::sscanf(line.c_str(), "%d %lx", &type,  &address);
+  if (cfg.get_sample_interval() > 0) {
+    run_sim_sampled(trace);
+    if (cfg.is_trace_stats()) trace.print_stats();
+    return;
+  }
 
-      if (type == REQ_IFETCH) {
-        m_mm->access(address, type);
-        m_num_insts++;
+  addr_t address;
+  int type;
 
-        if (m_num_insts % 100000 == 0) {
-          std::cout <<"Processed " << m_num_insts << " instructions\n";
-        }
+  while (true) {
+    if (!cfg.is_single_request() || m_mm->get_num_in_flight_reqs() == 0) {
+      if (!trace.next(&type, &address)) break;
 
-      } else if (type == REQ_DFETCH || type == REQ_DSTORE) {
+      if (is_core_req(type)) {
         m_mm->access(address, type);
-        m_num_mem_insts++;
+        count_inst(type);
       }
+    } else {
+      skip_idle_cycles();
     }
 
     run_a_cycle();
   }
 
   // keep running until all in-flight requests and write-backs are committed
+  drain();
+ 
+  std::cout << "------------------------------" << std::endl;
+  std::cout << "Performance Stats" << std::endl;
+  std::cout << "------------------------------" << std::endl;
+  std::cout << "CPI:  " << ((float) m_cycle / m_num_insts) << std::endl;
+  std::cout << "number of cycles: " << m_cycle << std::endl;
+  std::cout << "number of insts: " << m_num_insts << std::endl;
+  std::cout << "number of memory insts: " << m_num_mem_insts << std::endl;
+
+  if (cfg.is_trace_stats()) trace.print_stats();
+}
+
+void core_c::count_inst(int type) {
+  if (type == REQ_IFETCH) {
+    m_num_insts++;
+
+    if (m_num_insts % 100000 == 0) {
+      if (m_mm->get_num_cores() > 1) std::cout << "Core " << m_core_id << ": ";
+      std::cout <<"Processed " << m_num_insts << " instructions\n";
+    }
+
+  } else {
+    m_num_mem_insts++;
+  }
+}
+
+void core_c::drain() {
   while (m_mm->get_num_in_flight_reqs() != 0 || !m_mm->is_wb_done()) {
+    skip_idle_cycles();
     run_a_cycle();
   }
- 
+}
+
+/**
+ * Warms the caches functionally over the next checkpoint_insts instructions
+ * and saves them with the trace position (on top of "start" if this run was
+ * itself restored from a checkpoint).  The counts and cache statistics are
+ * then reset, so the rest of this run simulates exactly what a run restored
+ * from the new checkpoint does.
+ */
+void core_c::make_checkpoint(trace_prefetcher_c& trace, const checkpoint_s& start) {
+  const config_c& cfg = m_mm->m_config;
+  const counter target = cfg.get_checkpoint_insts();
+
+  // stop in front of the instruction past the prefix; its data records follow it
+  addr_t address;
+  int type;
+  while (trace.peek(&type, &address)) {
+    if (type == REQ_IFETCH && m_num_insts == target) break;
+    trace.next(&type, &address);
+    if (is_core_req(type)) {
+      m_mm->warm(address, type);
+      count_inst(type);
+    }
+  }
+
+  checkpoint_s ckpt;
+  ckpt.m_num_insts     = start.m_num_insts + m_num_insts;
+  ckpt.m_num_mem_insts = start.m_num_mem_insts + m_num_mem_insts;
+  if (!trace.get_pos(&ckpt.m_trace_pos) || !m_mm->save_checkpoint(cfg.get_checkpoint_save(), ckpt))
+    exit(1);
+
+  m_num_insts = 0;
+  m_num_mem_insts = 0;
+  for (cache_c* cache : m_mm->get_caches()) cache->reset_stats();
+}
+
+static void add_cache_stats(cache_stats_s* total, const cache_stats_s& stats) {
+  total->m_num_accesses   += stats.m_num_accesses;
+  total->m_num_hits       += stats.m_num_hits;
+  total->m_num_misses     += stats.m_num_misses;
+  total->m_num_writes     += stats.m_num_writes;
+  total->m_num_writebacks += stats.m_num_writebacks;
+  total->m_num_unsampled  += stats.m_num_unsampled;
+}
+
+/**
+ * Sampled timing (SMARTS-style).  The trace is cut into periods of
+ * sample_interval instructions.  The last sample_warmup + sample_unit
+ * instructions of each period run on the timing model; the first
+ * sample_warmup of them only warm up the queues and in-flight state, and the
+ * last sample_unit (the sampling unit) are measured.  Everything else only
+ * updates the tag stores (memory_hierarchy_c::warm), so the caches are warm
+ * when a detailed window starts.
+ *
+ * The cache statistics are reset at the start of every unit and read at its
+ * end, so warm-up references are left out; at the end the caches hold the sum
+ * over the units, which is what print_stats() then shows.  CPI and hit rates
+ * are estimated from the per-unit values with 95% confidence intervals.  A
+ * unit cut short by the end of the trace is dropped.
+ */
+void core_c::run_sim_sampled(trace_prefetcher_c& trace) {
+  const config_c& cfg = m_mm->m_config;
+  const counter interval = cfg.get_sample_interval();
+  const counter warmup   = cfg.get_sample_warmup();
+  const counter unit     = cfg.get_sample_unit();
+  if (cfg.get_sample_warmup() < 0 || cfg.get_sample_unit() <= 0 || warmup + unit > interval) {
+    fprintf(stderr, "[Error]: sampling needs sample_unit > 0, sample_warmup >= 0 and "
+                    "sample_warmup + sample_unit <= sample_interval\n");
+    exit(1);
+  }
+  const counter detail_start  = interval - warmup - unit;   // positions in a period
+  const counter measure_start = interval - unit;
+
+  const std::vector<cache_c*>& caches = m_mm->get_caches();
+  std::vector<cache_stats_s> measured(caches.size(), cache_stats_s());
+  std::vector<running_stat_c> hit_rate(caches.size());
+  running_stat_c cpi;
+
+  enum { FUNCTIONAL, WARMUP, MEASURE } phase = FUNCTIONAL;
+  counter unit_start_cycle = 0;
+  counter unit_start_inst  = 0;
+  counter num_detailed_insts = 0;
+
+  auto start_unit = [&]() {
+    for (cache_c* cache : caches) cache->reset_stats();
+    unit_start_cycle = m_cycle;
+    unit_start_inst  = m_num_insts;
+  };
+
+  auto end_unit = [&]() {
+    cpi.add((double)(m_cycle - unit_start_cycle) / (m_num_insts - unit_start_inst));
+    for (size_t ii = 0; ii < caches.size(); ++ii) {
+      cache_stats_s stats = caches[ii]->get_stats();
+      if (stats.m_num_accesses)
+        hit_rate[ii].add((double)stats.m_num_hits / stats.m_num_accesses * 100);
+      add_cache_stats(&measured[ii], stats);
+    }
+  };
+
+  addr_t address;
+  int type;
+
+  while (true) {
+    if (phase != FUNCTIONAL && cfg.is_single_request() && m_mm->get_num_in_flight_reqs() != 0) {
+      skip_idle_cycles();
+      run_a_cycle();
+      continue;
+    }
+
+    if (!trace.next(&type, &address)) break;
+    if (!is_core_req(type)) {
+      if (phase != FUNCTIONAL) run_a_cycle();
+      continue;
+    }
+
+    // the phase changes at instruction boundaries; data records follow their instruction
+    if (type == REQ_IFETCH) {
+      const counter pos = m_num_insts % interval;
+      if (pos == 0 && phase == MEASURE) end_unit();
+
+      const bool was_detailed = (phase != FUNCTIONAL);
+      phase = (pos < detail_start) ? FUNCTIONAL : (pos < measure_start) ? WARMUP : MEASURE;
+      if (was_detailed && phase == FUNCTIONAL) drain();
+      if (pos == measure_start) start_unit();
+    }
+
+    if (phase == FUNCTIONAL) {
+      m_mm->warm(address, type);
+      count_inst(type);
+      continue;
+    }
+
+    m_mm->access(address, type);
+    count_inst(type);
+    if (type == REQ_IFETCH) num_detailed_insts++;
+    run_a_cycle();
+  }
+
+  if (phase == MEASURE && m_num_insts - unit_start_inst == unit) end_unit();
+  drain();
+
+  // leave the sum over the measured units in the caches for print_stats()
+  for (size_t ii = 0; ii < caches.size(); ++ii) {
+    caches[ii]->reset_stats();
+    caches[ii]->add_stats(measured[ii]);
+  }
+
   std::cout << "------------------------------" << std::endl;
-  std::cout << "Performance Stats" << std::endl;
+  std::cout << "Sampled Performance Stats" << std::endl;
+  std::cout << "------------------------------" << std::endl;
+  std::cout << "CPI:  " << cpi.mean() << " +- " << cpi.confidence() << " (95% confidence)" << std::endl;
+  for (size_t ii = 0; ii < caches.size(); ++ii) {
+    std::cout << caches[ii]->get_name() << " hit rate: " << hit_rate[ii].mean()
+              << " +- " << hit_rate[ii].confidence() << " % (95% confidence)" << std::endl;
+  }
+  std::cout << "number of sampling units: " << cpi.count()
+            << " (" << unit << " insts each, " << warmup << " warm-up, every " << interval << ")" << std::endl;
+  std::cout << "number of detailed cycles: " << m_cycle << std::endl;
+  std::cout << "number of detailed insts: " << num_detailed_insts << std::endl;
+  std::cout << "number of insts: " << m_num_insts << std::endl;
+  std::cout << "number of memory insts: " << m_num_mem_insts << std::endl;
+}
+
+/**
+ * Multicore simulation: every cycle each core that is not stalled issues its
+ * next trace record (with single_request, a core stalls while its own request
+ * is out), then the shared hierarchy ticks once.  A core is finished when its
+ * trace is done and its last request has returned; that cycle is its cycle
+ * count.  The cycles up to the next memory event are skipped only while no
+ * core can issue.  Sampling and checkpoints are single-core only.
+ */
+void core_c::run_multicore(memory_hierarchy_c* mm, const std::vector<std::string>& filenames) {
+  const config_c& cfg = mm->m_config;
+  if (cfg.get_sample_interval() > 0 || cfg.get_checkpoint_save() != "none" ||
+      cfg.get_checkpoint_load() != "none") {
+    fprintf(stderr, "[Error]: sampling and checkpoints need a single core\n");
+    exit(1);
+  }
+
+  std::vector<core_c*> cores;
+  for (size_t ii = 0; ii < filenames.size(); ++ii)
+    cores.push_back(open_core(mm, ii, filenames[ii]));
+  counter cycle = run_cores(mm, cores);
+
+  counter num_insts = 0;
+  for (core_c* core : cores) {
+    core->print_stats();
+    num_insts += core->m_num_insts;
+  }
+  std::cout << "------------------------------" << std::endl;
+  std::cout << "Multicore Performance Stats" << std::endl;
+  std::cout << "------------------------------" << std::endl;
+  std::cout << "number of cores: " << cores.size() << std::endl;
+  std::cout << "number of cycles: " << cycle << std::endl;
+  std::cout << "number of insts: " << num_insts << std::endl;
+  std::cout << "aggregate IPC: " << ((float) num_insts / cycle) << std::endl;
+
+  if (cfg.is_multiprogram()) print_multiprogram_stats(cores, filenames);
+
+  for (core_c* core : cores) delete core;
+}
+
+core_c* core_c::open_core(memory_hierarchy_c* mm, int core_id, const std::string& filename) {
+  core_c* core = new core_c(mm, core_id);
+  core->m_trace = new trace_prefetcher_c(mm->m_config.get_trace_ring_depth());
+  if (!core->m_trace->open(filename)) {
+    fprintf(stderr, "[Error]: cannot open trace %s\n", filename.c_str());
+    exit(1);
+  }
+  return core;
+}
+
+/**
+ * Run "cores" on "mm" until every one is finished and the hierarchy has
+ * drained; returns the total number of cycles.
+ */
+counter core_c::run_cores(memory_hierarchy_c* mm, const std::vector<core_c*>& cores) {
+  const config_c& cfg = mm->m_config;
+  counter cycle = 0;
+  size_t num_running = cores.size();
+  while (num_running || mm->get_num_in_flight_reqs() != 0 || !mm->is_wb_done()) {
+    bool can_issue = false;
+    for (core_c* core : cores) {
+      if (core->m_trace_done) continue;
+      if (cfg.is_single_request() && mm->get_num_in_flight_reqs(core->m_core_id) != 0) continue;
+      core->issue_next();
+      can_issue = true;
+    }
+    if (!can_issue && cfg.is_cycle_skip()) cycle += mm->skip_idle_cycles();
+
+    mm->run_a_cycle();
+    ++cycle;
+
+    for (core_c* core : cores) {
+      if (core->m_finished || !core->m_trace_done || mm->get_num_in_flight_reqs(core->m_core_id)) continue;
+      core->m_finished = true;
+      core->m_cycle = cycle;
+      --num_running;
+    }
+  }
+  return cycle;
+}
+
+/**
+ * Multiprogrammed workloads: run each trace again alone on a single-core
+ * hierarchy of the same config, and compare.  The speedup of a program is
+ * its IPC in the mix over its IPC alone (at most 1 unless sharing helps):
+ *
+ *   weighted speedup      : sum of the speedups (throughput)
+ *   harmonic mean speedup : balances throughput and fairness
+ *   fairness              : min speedup / max speedup (1: even slowdown)
+ */
+void core_c::print_multiprogram_stats(const std::vector<core_c*>& cores,
+                                      const std::vector<std::string>& filenames) {
+  config_c cfg = cores[0]->m_mm->m_config;
+  std::vector<double> speedups;
+  std::cout << "------------------------------" << std::endl;
+  std::cout << "Multiprogram Stats" << std::endl;
+  std::cout << "------------------------------" << std::endl;
+  for (size_t ii = 0; ii < cores.size(); ++ii) {
+    memory_hierarchy_c* alone_mm = new memory_hierarchy_c(cfg, 1);
+    core_c* alone = open_core(alone_mm, 0, filenames[ii]);
+    run_cores(alone_mm, std::vector<core_c*>(1, alone));
+
+    const counter insts = cores[ii]->m_num_insts;
+    const double cpi_alone  = insts ? (double)alone->m_cycle / insts : 0.0;
+    const double cpi_shared = insts ? (double)cores[ii]->m_cycle / insts : 0.0;
+    speedups.push_back(cpi_shared > 0 ? cpi_alone / cpi_shared : 0.0);
+    std::cout << "core " << ii << " CPI alone: " << cpi_alone << std::endl;
+    std::cout << "core " << ii << " CPI shared: " << cpi_shared << std::endl;
+    std::cout << "core " << ii << " speedup: " << speedups.back() << std::endl;
+
+    delete alone;
+    delete alone_mm;
+  }
+
+  double weighted = 0.0, inverse = 0.0;
+  double min_speedup = speedups[0], max_speedup = speedups[0];
+  for (double speedup : speedups) {
+    weighted += speedup;
+    inverse += (speedup > 0) ? 1.0 / speedup : 0.0;
+    min_speedup = std::min(min_speedup, speedup);
+    max_speedup = std::max(max_speedup, speedup);
+  }
+  std::cout << "weighted speedup: " << weighted << std::endl;
+  std::cout << "harmonic mean speedup: " << (inverse > 0 ? speedups.size() / inverse : 0.0) << std::endl;
+  std::cout << "fairness (min/max speedup): " << (max_speedup > 0 ? min_speedup / max_speedup : 0.0)
+            << std::endl;
+}
+
+void core_c::issue_next() {
+  addr_t address;
+  int type;
+  if (!m_trace->next(&type, &address)) {
+    m_trace_done = true;
+    return;
+  }
+  if (is_core_req(type)) {
+    m_mm->access(address, type, m_core_id);
+    count_inst(type);
+  }
+}
+
+void core_c::print_stats() {
+  std::cout << "------------------------------" << std::endl;
+  std::cout << "Core " << m_core_id << " Performance Stats" << std::endl;
   std::cout << "------------------------------" << std::endl;
   std::cout << "CPI:  " << ((float) m_cycle / m_num_insts) << std::endl;
   std::cout << "number of cycles: " << m_cycle << std::endl;
@@ -72,6 +429,16 @@ void core_c::run_sim(std::string filename) {
   std::cout << "number of memory insts: " << m_num_mem_insts << std::endl;
 }
 
+/**
+ * While the core is not issuing, the cycles up to the next memory event only
+ * advance the clocks, so skip them in one step instead of ticking each one.
+ */
+void core_c::skip_idle_cycles() {
+  if (!m_mm->m_config.is_cycle_skip()) return;
+
+  m_cycle += m_mm->skip_idle_cycles();
+}
+
 void core_c::run_a_cycle() {
   m_mm->run_a_cycle();
 
@@ -6,20 +6,44 @@
 
 #include "memory_system/memory_hierarchy.h"
 #include <string>
+#include <vector>
+
+class trace_prefetcher_c;
 
 class core_c {
 public:
-  core_c(memory_hierarchy_c* mm);
+  core_c(memory_hierarchy_c* mm, int core_id = 0);
   ~core_c();
 
   void run_sim(std::string filename);
 
+  /// one core per trace on a hierarchy built for that many cores
+  static void run_multicore(memory_hierarchy_c* mm, const std::vector<std::string>& filenames);
+
 private:
   void run_a_cycle();
+  void skip_idle_cycles();     ///< jump to the next memory event while the core is stalled
+  void count_inst(int type);   ///< count a trace record that was issued
+  void drain();                ///< run until every in-flight request and write-back commits
+  void run_sim_sampled(trace_prefetcher_c& trace);  ///< sampled timing (sample_interval > 0)
+  void make_checkpoint(trace_prefetcher_c& trace, const checkpoint_s& start);  ///< checkpoint_save
+  void issue_next();           ///< multicore: this core's trace record for the cycle
+  void print_stats();          ///< multicore: per-core performance stats
+
+  static core_c* open_core(memory_hierarchy_c* mm, int core_id, const std::string& filename);
+  static counter run_cores(memory_hierarchy_c* mm, const std::vector<core_c*>& cores);  ///< # cycles
+  /// multiprogram: run each trace alone and report speedups, throughput and fairness
+  static void print_multiprogram_stats(const std::vector<core_c*>& cores,
+                                       const std::vector<std::string>& filenames);
 
 public:
   memory_hierarchy_c* m_mm;
-  counter m_cycle;
+  counter m_cycle;             // with several cores: the cycle this core finished
+
+  int  m_core_id;
+  trace_prefetcher_c* m_trace; // multicore: this core's trace
+  bool m_trace_done;           // multicore: trace read to the end
+  bool m_finished;             // multicore: ... and its last request is done
 
   counter m_num_insts;         // # instructions (this includes #mem insts)
   counter m_num_mem_insts;     // # memory instructions 
@@ -0,0 +1,57 @@
+// $ g++ -O2 -o cache_bench cache_bench.cc ../cache_base/cache_base.cc ../cache_base/tag_match.cc
+// $ ./cache_bench <trace> [cache size (in bytes)] [line size (in bytes)]
+
+#include "../cache_base/cache_base.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// The trace is parsed once up front, so the timed loop only measures
+// cache_base_c::access (the tag store lookup and update).
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "[Usage]: %s <trace> [cache size (in bytes)] [line size (in bytes)]\n", argv[0]);
+    return -1;
+  }
+
+  int cache_size = (argc > 2) ? atoi(argv[2]) : 32768;
+  int line_size  = (argc > 3) ? atoi(argv[3]) : 64;
+
+  std::vector<int>    types;
+  std::vector<addr_t> addrs;
+  std::ifstream trace_file(argv[1]);
+  std::string line;
+  while (std::getline(trace_file, line)) {
+    int type;
+    addr_t address;
+    if (std::sscanf(line.c_str(), "%d %lx", &type, &address) != 2) continue;
+    types.push_back(type);
+    addrs.push_back(address);
+  }
+
+  const int assocs[] = {2, 4, 8, 16};
+  for (int assoc : assocs) {
+    for (int policy = 0; policy < REPL_LAST; ++policy) {
+      if (policy == REPL_OPT) continue;   // needs next uses (run_base opt mode)
+      int num_sets = cache_size / (assoc * line_size);
+      cache_base_c cache("L1", num_sets, assoc, line_size, policy);
+
+      auto start = std::chrono::steady_clock::now();
+      for (size_t ii = 0; ii < addrs.size(); ++ii) {
+        cache.access(addrs[ii], types[ii], false);
+      }
+      std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+
+      printf("%6dB %2d-way %4d sets %-9s: %8.2f M accesses/sec%s\n",
+             cache_size, assoc, num_sets, repl_policy_name(policy),
+             addrs.size() / sec.count() / 1e6,
+             cache.is_specialized() ? " (specialized)" : "");
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,64 @@
+// $ g++ -O2 -o tag_match_bench tag_match_bench.cc ../cache_base/tag_match.cc
+// $ ./tag_match_bench
+
+#include "../cache_base/cache_base.h"
+#include "../cache_base/tag_match.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Looks up random keys in random full sets (about half of them hit) and
+// reports the lookup throughput of each tag_match kernel per associativity.
+static double run(tag_match_fn fn, const std::vector<uint64_t>& words,
+                  const std::vector<uint64_t>& keys, const std::vector<int>& sets,
+                  int assoc, uint64_t* checksum) {
+  auto start = std::chrono::steady_clock::now();
+  uint64_t sum = 0;
+  for (int round = 0; round < 16; ++round) {
+    for (size_t ii = 0; ii < keys.size(); ++ii) {
+      sum += fn(&words[(size_t)sets[ii] * assoc], assoc, keys[ii], tag_word::KEY_MASK);
+    }
+  }
+  std::chrono::duration<double> sec = std::chrono::steady_clock::now() - start;
+  *checksum = sum;
+  return 16.0 * keys.size() / sec.count() / 1e6;
+}
+
+int main() {
+  const int num_sets = 256;
+  const int num_keys = 1 << 20;
+  std::mt19937_64 rng(430322);
+
+  printf("selected kernel: %s\n", tag_match_kernel_name());
+  printf("assoc  scalar(M/s)  sse2(M/s)  avx2(M/s)\n");
+
+  const int assocs[] = {1, 2, 4, 8, 16, 32};
+  for (int assoc : assocs) {
+    std::vector<uint64_t> words((size_t)num_sets * assoc);
+    for (auto& w : words) w = tag_word::make(rng() >> 24, rng() & 1);
+
+    std::vector<uint64_t> keys(num_keys);
+    std::vector<int>      sets(num_keys);
+    for (int ii = 0; ii < num_keys; ++ii) {
+      sets[ii] = rng() % num_sets;
+      uint64_t word = words[(size_t)sets[ii] * assoc + rng() % assoc];
+      keys[ii] = (rng() & 1) ? (word & tag_word::KEY_MASK) : tag_word::key(rng() >> 24);
+    }
+
+    uint64_t c0, c1, c2;
+    double scalar = run(tag_match_scalar, words, keys, sets, assoc, &c0);
+#if defined(__x86_64__) || defined(__i386__)
+    double sse2 = run(tag_match_sse2, words, keys, sets, assoc, &c1);
+    double avx2 = __builtin_cpu_supports("avx2") ? run(tag_match_avx2, words, keys, sets, assoc, &c2) : 0;
+    if (!__builtin_cpu_supports("avx2")) c2 = c0;
+#else
+    double sse2 = 0, avx2 = 0;
+    c1 = c2 = c0;
+#endif
+    printf("%5d  %11.1f  %9.1f  %9.1f%s\n", assoc, scalar, sse2, avx2,
+           (c0 == c1 && c0 == c2) ? "" : "  MISMATCH");
+  }
+  return 0;
+}
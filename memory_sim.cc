@@ -7,17 +7,28 @@
 
 #include <cstdio>
 #include <string>
+#include <vector>
 
 ////////////////////////////////////////////////////////////////////////////////
 int main(int argc, char** argv) {
-  if (argc != 3) {
-    fprintf(stderr, "[Usage]: %s <trace> <config file>\n", argv[0]);
+  if (argc < 3) {
+    fprintf(stderr, "[Usage]: %s <trace> [<trace> ...] <config file>\n", argv[0]);
     return -1;
   }
   
-  config_c config(argv[2]);
+  config_c config(argv[argc - 1]);
+
+  // one core per trace
+  std::vector<std::string> traces(argv + 1, argv + argc - 1);
+  memory_hierarchy_c* mm = new memory_hierarchy_c(config, traces.size());
+
+  if (traces.size() > 1) {
+    core_c::run_multicore(mm, traces);
+    mm->print_stats();
+    delete mm;
+    return 0;
+  }
 
-  memory_hierarchy_c* mm = new memory_hierarchy_c(config);
   core_c* m_core = new core_c(mm);
 
   m_core->run_sim(argv[1]);
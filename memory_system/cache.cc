@@ -7,17 +7,36 @@
 #include <cassert>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
+#include <unordered_set>
 
-cache_c::cache_c(std::string name, int level, int num_set, int assoc, int line_size, int latency)
-    : cache_base_c(name, num_set, assoc, line_size) {
+static const char* inclusion_names[INCL_LAST] = {"inclusive", "non_inclusive", "exclusive"};
+
+int parse_inclusion(const std::string& name) {
+  for (int ii = 0; ii < INCL_LAST; ++ii) {
+    if (name == inclusion_names[ii]) return ii;
+  }
+  return -1;
+}
+
+const char* inclusion_name(int type) {
+  return (type >= 0 && type < INCL_LAST) ? inclusion_names[type] : "unknown";
+}
+
+cache_c::cache_c(std::string name, int level, int num_set, int assoc, int line_size, int latency,
+                 int repl_policy, uint64_t repl_seed, bool sparse)
+    : cache_base_c(name, num_set, assoc, line_size, repl_policy, repl_seed, sparse) {
 
   // instantiate queues
-  m_in_queue   = new queue_c();
-  m_out_queue  = new queue_c();
-  m_fill_queue = new queue_c();
-  m_wb_queue   = new queue_c();
+  m_in_queue   = new ready_queue_c();
+  m_out_queue  = new ready_queue_c();
+  m_fill_queue = new ready_queue_c();
+  m_wb_queue   = new ready_queue_c();
+  m_pf_queue   = new ready_queue_c(PF_QUEUE_SIZE);
+  m_coh_queue  = new ready_queue_c();
 
-  m_in_flight_wb_queue = new queue_c();
+  m_num_in_flight_wbs = 0;
+  m_num_in_flight_pfs = 0;
 
   m_id = 0;
 
@@ -25,6 +44,11 @@ cache_c::cache_c(std::string name, int level, int num_set, int assoc, int line_s
   m_prev_d = nullptr;
   m_next = nullptr;
   m_memory = nullptr;
+  m_req_pool = nullptr;
+
+  m_core_id = 0;
+  m_directory = nullptr;
+  m_coh_id = -1;
 
   m_latency = latency;
   m_level = level;
@@ -34,6 +58,19 @@ cache_c::cache_c(std::string name, int level, int num_set, int assoc, int line_s
   
   m_num_backinvals = 0;
   m_num_writebacks_backinval = 0;
+
+  m_inclusion = INCL_INCLUSIVE;
+  m_report_inclusion = false;
+  m_num_inclusion_victims = 0;
+  m_num_victim_fills = 0;
+  m_num_clean_victim_fills = 0;
+  m_num_moved_up = 0;
+  m_num_peer_transfers = 0;
+
+  m_mshr_occupancy = 0;
+  m_mshr_max_occupancy = 0;
+  m_num_mshr_merges = 0;
+  m_num_mshr_full_stalls = 0;
 }
 
 cache_c::~cache_c() {
@@ -41,7 +78,8 @@ cache_c::~cache_c() {
   delete m_out_queue;
   delete m_fill_queue;
   delete m_wb_queue;
-  delete m_in_flight_wb_queue;
+  delete m_pf_queue;
+  delete m_coh_queue;
 }
 
 /** 
@@ -58,11 +96,70 @@ void cache_c::run_a_cycle() {
   ++m_cycle;
 }
 
-void cache_c::configure_neighbors(cache_c* prev_i, cache_c* prev_d, cache_c* next, simple_mem_c* memory) {
+/**
+ * A tick does nothing until some queued request becomes ready, so the next
+ * event is the earliest ready cycle over all the queues.
+ */
+counter cache_c::get_next_event_cycle() const {
+  counter next = m_in_queue->get_earliest_rdy_cycle();
+  next = std::min(next, m_out_queue->get_earliest_rdy_cycle());
+  next = std::min(next, m_fill_queue->get_earliest_rdy_cycle());
+  next = std::min(next, m_wb_queue->get_earliest_rdy_cycle());
+  next = std::min(next, m_pf_queue->get_earliest_rdy_cycle());
+  next = std::min(next, m_coh_queue->get_earliest_rdy_cycle());
+  return next;
+}
+
+void cache_c::skip_cycles(counter num_cycles) {
+  m_cycle += num_cycles;
+  m_mshr_occupancy += (counter)m_mshr.size() * num_cycles;
+}
+
+/**
+ * Set up the miss status holding registers; with zero entries (the default)
+ * every miss is sent to the next level.
+ */
+void cache_c::configure_mshr(int num_entries, int num_targets) {
+  m_mshr.init(num_entries, num_targets);
+}
+
+/**
+ * Attach a prefetcher (see prefetcher_c); it trains on the demand lookups of
+ * this cache and fills this cache only.
+ */
+void cache_c::configure_prefetcher(int type, int degree, int distance, bool throttle) {
+  m_prefetcher.init(type, degree, distance, throttle, get_line_size(),
+                    get_num_sets() * get_assoc());
+}
+
+void cache_c::configure_neighbors(cache_c* prev_i, cache_c* prev_d, cache_c* next, main_memory_c* memory) {
   m_prev_i = prev_i;
   m_prev_d = prev_d;
   m_next = next;
   m_memory = memory;
+  m_uppers_i.assign(1, prev_i);
+  m_uppers_d.assign(1, prev_d);
+}
+
+/**
+ * A level shared by several cores gets the private caches of core 1, 2, ...
+ * here (core 0's come from configure_neighbors); data goes back to the core
+ * in the request.
+ */
+void cache_c::add_upper_core(cache_c* prev_i, cache_c* prev_d) {
+  m_uppers_i.push_back(prev_i);
+  m_uppers_d.push_back(prev_d);
+  set_num_sources(m_uppers_i.size());
+}
+
+/**
+ * Split the ways among the cores added so far (see partition_c); call after
+ * the last add_upper_core().
+ */
+void cache_c::configure_partition(int type, const std::string& ways, counter interval) {
+  m_partition.init(type, get_num_sources(), get_num_sets(), get_assoc(), get_line_size(),
+                   ways, interval);
+  if (m_partition.is_enabled()) set_way_masks(m_partition.get_masks());
 }
 
 /**
@@ -80,6 +177,7 @@ bool cache_c::fill(mem_req_s* req) {
   if (m_fill_queue->full()) return false;
   req->m_rdy_cycle = m_cycle + m_latency;
   m_fill_queue->push(req);
+  if (req->m_type == REQ_WB) ++m_num_in_flight_wbs;
   return true;
 }
 
@@ -105,82 +203,147 @@ bool cache_c::access(mem_req_s* req) {
  * 2. performs a cache lookup in the "cache base" after the intrinsic access time
  * 3. on a cache hit, forward the request to the prev's fill_queue or the processor depending on the cache level.
  * 4. on a cache miss, put the current requests into out_queue
+ *
+ * With MSHRs, a request to a line that is already being fetched is merged
+ * onto the outstanding miss and returns with its fill (the tag store is still
+ * looked up, so the hit/miss stats follow the reference stream).  A request
+ * that needs a full MSHR entry or a new entry in a full table stalls the
+ * in_queue until a fill frees one.
+ *
+ * A prefetch from an upper level is looked up like a miss would be, but
+ * without counting as an access, and returns to the cache that issued it.
+ * Demand lookups train this cache's own prefetcher.
+ *
+ * With a MESI directory, a store to a line a private L1 only holds shared is
+ * an upgrade: it hits, but goes down like a miss to get ownership.  The
+ * shared level resolves every request from an L1 with the directory, and a
+ * hit that had to invalidate or downgrade another L1 waits the coherence
+ * latency before it goes back up.
+ *
+ * A level shared by several cores counts each core's lookups separately,
+ * and with way partitioning a core's miss only replaces one of its ways.
+ *
+ * An exclusive L2 allocates nothing on a miss (the data only passes through
+ * on its way up), and a hit moves the line up to the L1.  With several
+ * cores, a miss to a line another L1 holds is served by that L1 after the
+ * coherence latency instead of by memory.
  */
 void cache_c::process_in_queue() {
-  for (auto it = m_in_queue->m_entry.begin(); it != m_in_queue->m_entry.end(); /**/) {
-    mem_req_s* req = *it;
-    if (req->m_rdy_cycle > m_cycle) { ++it; continue; }
-
-    addr_t ev_addr = 0; bool ev_dirty = false;
-    bool hit = cache_base_c::access(req->m_addr, req->m_type, /*is_fill*/false,
-                                    &ev_addr, &ev_dirty);
-
-    if (m_level == MEM_L2 && ev_addr) {
-      if (m_prev_d) {
-        bool d = false;
-        if (m_prev_d->invalidate(ev_addr, &d)) {
-          m_prev_d->m_num_backinvals++;
-          if (d) {
-            m_prev_d->m_num_writebacks_backinval++;
-            auto* wb2 = new mem_req_s(ev_addr, REQ_WB);
-            wb2->m_dirty = true;
-            wb2->m_rdy_cycle = m_cycle;
-            m_wb_queue->push(wb2);
-          }
-        }
+  while (mem_req_s* req = m_in_queue->peek_ready(m_cycle)) {
+    const bool upgrade = needs_upgrade(req);
+    mshr_entry_s* entry = nullptr;
+    if (m_mshr.is_enabled()) {
+      entry = m_mshr.find(get_line_addr(req->m_addr));
+      if (entry ? !m_mshr.can_merge(entry) : (m_mshr.full() && (upgrade || !probe(req->m_addr)))) {
+        m_num_mshr_full_stalls++;
+        break;
       }
-      if (m_prev_i) {
-        bool d2 = false;
-        if (m_prev_i->invalidate(ev_addr, &d2)) {
-          m_prev_i->m_num_backinvals++;
-        }
+    }
+
+    const bool   is_prefetch = (req->m_type == REQ_PREFETCH);
+    const addr_t addr = req->m_addr;
+    const int    core = req->m_core_id;
+
+    if (get_num_sources()) {
+      if (m_partition.is_enabled() && !is_prefetch) {
+        m_partition.on_access(addr, core);
+        if (m_partition.update(m_cycle)) set_way_masks(m_partition.get_masks());
       }
+      set_source(core);
     }
 
-    // Victim → wb_queue
-    if (ev_dirty) {
-      auto* wb = new mem_req_s(ev_addr, REQ_WB);
-      wb->m_dirty = true;
-      wb->m_rdy_cycle = m_cycle;
-      m_wb_queue->push(wb);
+    addr_t ev_addr = 0; bool ev_dirty = false;
+    bool hit;
+    if (is_exclusive()) {
+      hit = is_prefetch ? probe(addr) : cache_base_c::lookup(addr, req->m_type);
+    } else {
+      hit = cache_base_c::access(req->m_addr, req->m_type, /*is_fill*/is_prefetch,
+                                 &ev_addr, &ev_dirty);
+      evict_victim(ev_addr, ev_dirty, false);
     }
 
-    it = m_in_queue->m_entry.erase(it);   // pop
+    if (!hit && !is_prefetch && !m_backinval_lines.empty()) {
+      addr_t& lost = m_backinval_lines[get_line_addr(addr) % m_backinval_lines.size()];
+      if (lost == get_line_addr(addr) + 1) {
+        ++m_num_inclusion_victims;
+        lost = 0;
+      }
+    }
 
-    if (hit) {
-      if (!m_prev_i && !m_prev_d && done_func) {
-        req->m_rdy_cycle = m_cycle;
-        done_func(req);
+    int  num_remote = 0;
+    bool peer = false;
+    if (m_directory && m_coh_id < 0) {
+      const cache_c* source = is_prefetch ? req->m_pf_source :
+                              (req->m_type == REQ_IFETCH) ? m_uppers_i[core] : m_uppers_d[core];
+      peer = !hit && is_exclusive() && m_directory->has_other_copy(addr, source->m_coh_id);
+      bool remote_dirty = false;
+      num_remote = m_directory->request(addr, source->m_coh_id, req->m_dirty, &remote_dirty);
+      if (remote_dirty) {
+        // the modified copy comes back with the intervention
+        cache_base_c::install_writeback(addr, &ev_addr, &ev_dirty);
+        evict_victim(ev_addr, ev_dirty, false);
+      }
+    }
+
+    m_in_queue->pop();
+
+    if (entry) {
+      // secondary miss: wait for the outstanding fill
+      entry->m_targets.push_back(req);
+      m_num_mshr_merges++;
+    } else if ((hit || peer) && !upgrade) {
+      if (hit && is_exclusive()) move_up(req);
+      if (peer) ++m_num_peer_transfers;
+      if (num_remote || peer) {
+        req->m_rdy_cycle = m_cycle + m_directory->get_latency();
+        m_coh_queue->push(req);
       } else {
-        if (req->m_type == REQ_IFETCH && m_prev_i)
-          m_prev_i->fill(req);
-        else if (m_prev_d)
-          m_prev_d->fill(req);
-        else if (m_prev_i)
-          m_prev_i->fill(req);
+        send_up(req);
       }
     } else {
       // miss -> out_queue
-      req->m_rdy_cycle = m_cycle;
-      if (req->m_type == REQ_DSTORE) {
-        req->m_dirty = true;          // remember to mark dirty on fill
-        req->m_type = REQ_DFETCH;     // treat as read for lower levels
-      }
-      m_out_queue->push(req);
+      send_miss(req);
+    }
+
+    if (m_prefetcher.is_enabled() && !is_prefetch) {
+      m_prefetcher.on_demand(addr, hit, &m_pf_addrs);
+      issue_prefetches(core);
     }
   }
+
+  if (m_mshr.size() > m_mshr_max_occupancy) m_mshr_max_occupancy = m_mshr.size();
+  m_mshr_occupancy += m_mshr.size();
+}
+
+void cache_c::send_miss(mem_req_s* req) {
+  req->m_rdy_cycle = m_cycle;
+  if (req->m_type == REQ_DSTORE) {
+    req->m_dirty = true;          // remember to mark dirty on fill
+    req->m_type = REQ_DFETCH;     // treat as read for lower levels
+  }
+  if (m_mshr.is_enabled())
+    m_mshr.alloc(get_line_addr(req->m_addr), req);
+  m_out_queue->push(req);
+}
+
+bool cache_c::needs_upgrade(const mem_req_s* req) const {
+  return m_directory && m_coh_id >= 0 && req->m_type == REQ_DSTORE && probe(req->m_addr) &&
+         !m_directory->is_exclusive(req->m_addr, m_coh_id);
 }
 
 /** 
  * This function processes the output queue.
  * The function pops the requests from out_queue and accesses the next-level's cache or main memory.
  * CURRENT: There is no limit on the number of requests we can process in a cycle.
+ *
+ * Prefetches have low priority: they go down only once every ready miss has.
  */
 void cache_c::process_out_queue() {
-  for (auto it = m_out_queue->m_entry.begin(); it != m_out_queue->m_entry.end(); /**/) {
-    mem_req_s* req = *it;
-    if (req->m_rdy_cycle > m_cycle) { ++it; continue; }
+  if (send_down(m_out_queue)) send_down(m_pf_queue);
+}
 
+bool cache_c::send_down(ready_queue_c* queue) {
+  while (mem_req_s* req = queue->peek_ready(m_cycle)) {
     bool accepted = false;
     if (m_next)
       accepted = m_next->access(req);
@@ -188,76 +351,277 @@ void cache_c::process_out_queue() {
       accepted = m_memory->access(req);
     else                 assert(false && "No next-level defined!");
 
-    if (accepted) it = m_out_queue->m_entry.erase(it);
-    else          ++it;   // back-pressure
+    // back-pressure: every request goes to the same place, so stop for this cycle
+    if (!accepted) return false;
+    queue->pop();
   }
+  return true;
+}
+
+/**
+ * Queue the prefetches the prefetcher asked for, skipping lines that are
+ * already here or on their way.  With MSHRs a prefetch takes an entry, so a
+ * demand miss to its line merges onto it; prefetches that find the MSHRs or
+ * the prefetch queue full are dropped.  A prefetch belongs to the core whose
+ * lookup triggered it.
+ */
+void cache_c::issue_prefetches(int core_id) {
+  for (addr_t addr : m_pf_addrs) {
+    const addr_t line = get_line_addr(addr);
+    if (probe(addr) || m_prefetcher.is_in_flight(line)) continue;
+    if (m_mshr.is_enabled() && (m_mshr.full() || m_mshr.find(line))) continue;
+    if (m_pf_queue->full()) break;
+
+    mem_req_s* req = m_req_pool->alloc(addr, REQ_PREFETCH);
+    req->m_id = 0;
+    req->m_in_cycle = m_cycle;
+    req->m_rdy_cycle = m_cycle;
+    req->m_done = false;
+    req->m_dirty = false;
+    req->m_pf_source = this;
+    req->m_core_id = core_id;
+
+    if (m_mshr.is_enabled()) m_mshr.alloc(line, req);
+    m_pf_queue->push(req);
+    ++m_num_in_flight_pfs;
+    m_prefetcher.on_issue(line);
+  }
+  m_pf_addrs.clear();
 }
 
 
 /** 
  * This function processes the fill queue.  The fill queue contains both the
  * data from the lower level and the dirty victim from the upper level.
+ * The shared level then sends up the hits whose coherence latency is over.
  */
 
 void cache_c::process_fill_queue() {
-  for (auto it = m_fill_queue->m_entry.begin(); it != m_fill_queue->m_entry.end(); /**/) {
-    mem_req_s* req = *it;
-    if (req->m_rdy_cycle > m_cycle) { ++it; continue; }
+  while (mem_req_s* req = m_fill_queue->peek_ready(m_cycle)) {
+    const bool own_prefetch = (req->m_type == REQ_PREFETCH && req->m_pf_source == this);
+    if (get_num_sources()) set_source(req->m_core_id);   // fills the core's own ways
 
     addr_t ev_addr = 0; bool ev_dirty = false;
     if (req->m_type == REQ_WB) {
-      cache_base_c::install_writeback(req->m_addr, &ev_addr, &ev_dirty);
+      if (req->m_dirty)
+        cache_base_c::install_writeback(req->m_addr, &ev_addr, &ev_dirty);
+      else
+        cache_base_c::access(req->m_addr, REQ_DFETCH, /*is_fill*/true, &ev_addr, &ev_dirty);
+      if (is_exclusive()) {
+        ++m_num_victim_fills;
+        if (!req->m_dirty) ++m_num_clean_victim_fills;
+      }
+    } else if (is_exclusive() && !own_prefetch) {
+      // exclusive: data for an upper level is not kept here
     } else {
       int fill_type = req->m_type;
       if (req->m_dirty && m_level == MEM_L1 && req->m_type == REQ_DFETCH)
         fill_type = REQ_DSTORE;
-      cache_base_c::access(req->m_addr, fill_type, /*is_fill*/true,
-                           &ev_addr, &ev_dirty);
+      bool present = cache_base_c::access(req->m_addr, fill_type, /*is_fill*/true,
+                                          &ev_addr, &ev_dirty);
+      if (own_prefetch) m_prefetcher.on_fill(get_line_addr(req->m_addr), present);
     }
+    evict_victim(ev_addr, ev_dirty, own_prefetch);
 
-    if (m_level == MEM_L2 && ev_addr) {
-      if (m_prev_d) {
-        bool d=false;
-        if (m_prev_d->invalidate(ev_addr, &d)) {
-          m_prev_d->m_num_backinvals++;
-          if (d) {
-            m_prev_d->m_num_writebacks_backinval++;
-            auto* wb2 = new mem_req_s(ev_addr, REQ_WB);
-            wb2->m_dirty = true;
-            wb2->m_rdy_cycle = m_cycle;
-            m_wb_queue->push(wb2);
-          }
-        }
-      }
-      if (m_prev_i) {
-        bool d2=false;
-        if (m_prev_i->invalidate(ev_addr, &d2))
-          m_prev_i->m_num_backinvals++;
+    m_fill_queue->pop();
+
+    if (req->m_type == REQ_PREFETCH) {
+      // a prefetch ends at the cache that issued it
+      if (m_mshr.is_enabled()) release_mshr(req);
+      if (own_prefetch) {
+        --m_num_in_flight_pfs;
+        m_req_pool->free(req);
+      } else {
+        req->m_pf_source->fill(req);
       }
+      continue;
+    }
+
+    if (req->m_type != REQ_WB) {
+      send_up(req);
+      if (m_mshr.is_enabled()) release_mshr(req);
+    } else {
+      --m_num_in_flight_wbs;          // write-back absorbed by this level
+      m_req_pool->free(req);
     }
+  }
 
-    // Victim write-back
-    if (ev_dirty) {
-      auto* wb = new mem_req_s(ev_addr, REQ_WB);
-      wb->m_dirty = true;
-      wb->m_rdy_cycle = m_cycle;
-      m_wb_queue->push(wb);
+  // hits that waited for a coherence intervention go up after the fills
+  process_coh_queue();
+}
+
+/**
+ * The fill for "req" (a primary miss) is installed: send the requests merged
+ * onto it the same way as the primary and free the MSHR entry.  A merged
+ * store that finds the line only shared (MESI) goes down again as an upgrade.
+ */
+void cache_c::release_mshr(mem_req_s* req) {
+  mshr_entry_s* entry = m_mshr.find(get_line_addr(req->m_addr));
+  assert(entry && entry->m_primary == req && "fill without an MSHR entry");
+
+  std::vector<mem_req_s*> upgrades;
+  for (mem_req_s* target : entry->m_targets) {
+    if (m_level == MEM_L1 && target->m_type == REQ_DSTORE) {
+      if (needs_upgrade(target)) {
+        upgrades.push_back(target);
+        continue;
+      }
+      // commit a merged store now that the line is here
+      cache_base_c::access(target->m_addr, REQ_DSTORE, /*is_fill*/true);
     }
+    send_up(target);
+  }
+
+  m_mshr.release(entry);
+
+  for (mem_req_s* target : upgrades) {
+    mshr_entry_s* pending = m_mshr.find(get_line_addr(target->m_addr));
+    if (pending)
+      pending->m_targets.push_back(target);
+    else
+      send_miss(target);
+  }
+}
+
+/**
+ * Send the data for "req" to the cache it came from: the issuing cache for a
+ * prefetch, the core (done target) at the top level, otherwise the I- or
+ * D-cache above of the request's core.
+ */
+void cache_c::send_up(mem_req_s* req) {
+  req->m_rdy_cycle = m_cycle;
+  if (req->m_type == REQ_PREFETCH) {
+    req->m_pf_source->fill(req);
+    return;
+  }
+  if (!m_prev_i && !m_prev_d && m_done_target) {
+    complete(req);
+    return;
+  }
+
+  cache_c* prev_i = m_uppers_i[req->m_core_id];
+  cache_c* prev_d = m_uppers_d[req->m_core_id];
+  if (req->m_type == REQ_IFETCH && prev_i)
+    prev_i->fill(req);
+  else if (prev_d)
+    prev_d->fill(req);
+  else if (prev_i)
+    prev_i->fill(req);
+}
+
+/**
+ * A hit from the in_queue whose coherence intervention is done goes up.
+ */
+void cache_c::process_coh_queue() {
+  while (mem_req_s* req = m_coh_queue->peek_ready(m_cycle)) {
+    m_coh_queue->pop();
+    send_up(req);
+  }
+}
+
+/**
+ * Everything a line leaving this cache (by a lookup, fill or write-back
+ * install) sets off: the prefetcher bookkeeping, back-invalidation of the
+ * upper levels (inclusive L2), the directory entry (private L1), and the
+ * write-back of dirty data.  Above an exclusive L2, clean victims go down
+ * as well.
+ */
+void cache_c::evict_victim(addr_t ev_addr, bool ev_dirty, bool by_prefetch) {
+  if (ev_addr) {
+    if (m_prefetcher.is_enabled()) m_prefetcher.on_evict(get_line_addr(ev_addr), by_prefetch);
+    if (m_level == MEM_L2 && m_inclusion == INCL_INCLUSIVE) back_invalidate(ev_addr);
+    if (m_directory && m_coh_id >= 0) m_directory->evict(ev_addr, m_coh_id);
+  }
+
+  // Victim → wb_queue
+  if (ev_dirty) {
+    push_wb_req(ev_addr);
+  } else if (ev_addr && m_next && m_next->is_exclusive()) {
+    push_wb_req(ev_addr, false);
+  }
+}
 
-    it = m_fill_queue->m_entry.erase(it);   // pop
-
-    if (!m_prev_i && !m_prev_d && done_func) {
-      req->m_rdy_cycle = m_cycle;
-      done_func(req);
-    } else if (req->m_type != REQ_WB) {
-      if (req->m_type == REQ_IFETCH && m_prev_i)
-        m_prev_i->fill(req);
-      else if (m_prev_d)
-        m_prev_d->fill(req);
-      else if (m_prev_i)
-        m_prev_i->fill(req);
+void cache_c::back_invalidate(addr_t ev_addr) {
+  for (size_t ii = 0; ii < m_uppers_d.size(); ++ii) {
+    if (cache_c* prev_d = m_uppers_d[ii]) {
+      bool d = false;
+      if (prev_d->invalidate(ev_addr, &d)) {
+        prev_d->record_backinval(ev_addr);
+        if (d) {
+          prev_d->m_num_writebacks_backinval++;
+          push_wb_req(ev_addr);
+        }
+      }
+    }
+    if (cache_c* prev_i = m_uppers_i[ii]) {
+      if (prev_i->invalidate(ev_addr))
+        prev_i->record_backinval(ev_addr);
     }
   }
+  if (m_directory) m_directory->remove(ev_addr);
+}
+
+/**
+ * Remember the line, so a later demand miss to it counts as an inclusion
+ * victim (a miss the L1 would not have had without inclusion).
+ */
+void cache_c::record_backinval(addr_t addr) {
+  m_num_backinvals++;
+  if (m_backinval_lines.empty()) return;
+  const addr_t line = get_line_addr(addr);
+  m_backinval_lines[line % m_backinval_lines.size()] = line + 1;
+}
+
+/**
+ * The filter has one entry per line of this cache.  It is only kept when
+ * the L2 reports its inclusion stats.
+ */
+void cache_c::track_inclusion_victims() {
+  m_backinval_lines.assign(get_num_sets() * get_assoc(), 0);
+}
+
+/**
+ * Exclusive L2: a hit hands the line to the L1 and drops it here.  Modified
+ * data goes up with a data read, which the L1 installs dirty; other requests
+ * write it back to memory instead.
+ */
+void cache_c::move_up(mem_req_s* req) {
+  bool dirty = false;
+  cache_base_c::invalidate(req->m_addr, &dirty);
+  ++m_num_moved_up;
+  if (!dirty) return;
+  if (req->m_type == REQ_DFETCH)
+    req->m_dirty = true;
+  else
+    push_wb_req(req->m_addr);
+}
+
+/**
+ * Send a done request to wherever this cache was connected.
+ */
+void cache_c::complete(mem_req_s* req) {
+  switch (m_done_target.m_kind) {
+    case done_target_s::HIERARCHY:
+      m_done_target.m_mm->push_done_req(req);
+      break;
+    default:
+      assert(false && "done target not connected");
+  }
+}
+
+/**
+ * Queue a dirty victim for write-back to the next level.  Write-backs count as
+ * in flight while they are inside this cache, so the
+ * simulation does not finish before they are committed.  A clean victim for
+ * an exclusive L2 travels the same way.
+ */
+void cache_c::push_wb_req(addr_t addr, bool dirty) {
+  mem_req_s* wb = m_req_pool->alloc(addr, REQ_WB);
+  wb->m_dirty = dirty;
+  wb->m_rdy_cycle = m_cycle;
+  wb->m_core_id = m_core_id;
+  m_wb_queue->push(wb);
+  ++m_num_in_flight_wbs;
 }
 
 /** 
@@ -266,19 +630,75 @@ void cache_c::process_fill_queue() {
  * CURRENT: There is no limit on the number of requests we can process in a cycle.
  */
 void cache_c::process_wb_queue() {
-  for (auto it = m_wb_queue->m_entry.begin(); it != m_wb_queue->m_entry.end(); /**/) {
-    mem_req_s* req = *it;
-    if (req->m_rdy_cycle > m_cycle) { ++it; continue; }
-
+  while (mem_req_s* req = m_wb_queue->peek_ready(m_cycle)) {
     bool accepted = false;
-    if (m_next)
+    if (m_next) {
       accepted = m_next->fill(req);
-    else if (m_memory)
-      accepted = m_memory->access(req);
+    } else if (m_memory) {
+      // main memory deletes write-backs itself, so it gets a heap copy
+      mem_req_s* wb = new mem_req_s(*req);
+      accepted = m_memory->access(wb);
+      if (!accepted) delete wb;
+    }
 
-    if (accepted) {
-      it = m_wb_queue->m_entry.erase(it);
-    } else ++it;
+    if (!accepted) break;   // back-pressure
+    m_wb_queue->pop();
+    --m_num_in_flight_wbs;
+    if (!m_next) m_req_pool->free(req);   // main memory has its own copy
+  }
+}
+
+/**
+ * [Functional Warming]
+ *
+ * Apply a reference to the tag stores the way the timing path eventually
+ * does, but all at once and without requests, queues or cycles: look up this
+ * level (allocating on a miss), go to the next level on a miss, then fill.
+ * Victims are back-invalidated and written back to the next level directly.
+ * Used to keep the caches warm between the detailed windows of a sampled run.
+ * Returns true on a hit at this level.  An exclusive L2 only gives up the
+ * line on a hit, like move_up(): modified data goes up with a data read
+ * ("*moved_dirty"), and otherwise to main memory, which keeps no state.
+ */
+bool cache_c::warm(addr_t addr, int type, bool* moved_dirty) {
+  if (is_exclusive()) {
+    bool hit = cache_base_c::lookup(addr, type);
+    bool dirty = false;
+    if (hit) cache_base_c::invalidate(addr, &dirty);
+    if (moved_dirty) *moved_dirty = dirty && type == REQ_DFETCH;
+    return hit;
+  }
+
+  addr_t ev_addr = 0; bool ev_dirty = false;
+  bool hit = cache_base_c::access(addr, type, /*is_fill*/false, &ev_addr, &ev_dirty);
+  warm_victim(ev_addr, ev_dirty);
+  if (hit) return true;
+
+  // lower levels see stores as reads; the fill marks the line dirty here
+  bool moved_dirty_up = false;
+  if (m_next) m_next->warm(addr, (type == REQ_DSTORE) ? REQ_DFETCH : type, &moved_dirty_up);
+
+  ev_addr = 0; ev_dirty = false;
+  const int fill_type = (moved_dirty_up && type == REQ_DFETCH) ? REQ_DSTORE : type;
+  cache_base_c::access(addr, fill_type, /*is_fill*/true, &ev_addr, &ev_dirty);
+  warm_victim(ev_addr, ev_dirty);
+  return false;
+}
+
+void cache_c::warm_victim(addr_t ev_addr, bool ev_dirty) {
+  if (m_level == MEM_L2 && m_inclusion == INCL_INCLUSIVE && ev_addr) {
+    // inclusive L2: the upper levels lose the line too (a dirty L1D copy
+    // goes to main memory, which keeps no state)
+    if (m_prev_d) m_prev_d->invalidate(ev_addr);
+    if (m_prev_i) m_prev_i->invalidate(ev_addr);
+  }
+
+  if (ev_dirty && m_next) {
+    m_next->install_writeback(ev_addr, &ev_addr, &ev_dirty);
+    m_next->warm_victim(ev_addr, ev_dirty);
+  } else if (ev_addr && m_next && m_next->is_exclusive()) {
+    m_next->cache_base_c::access(ev_addr, REQ_DFETCH, /*is_fill*/true, &ev_addr, &ev_dirty);
+    m_next->warm_victim(ev_addr, ev_dirty);
   }
 }
 
@@ -290,3 +710,76 @@ void cache_c::print_stats() {
   std::cout << "number of back invalidations: " << m_num_backinvals << "\n";
   std::cout << "number of writebacks due to back invalidations: " << m_num_writebacks_backinval << "\n";
 }
+
+/**
+ * Statistics of the features added to the base cache, each only when the
+ * feature is in use.
+ */
+void cache_c::print_ext_stats() {
+  if (m_mshr.is_enabled()) {
+    std::cout << "average MSHR occupancy: " << (double)m_mshr_occupancy / m_cycle << "\n";
+    std::cout << "max MSHR occupancy: " << m_mshr_max_occupancy << "\n";
+    std::cout << "number of MSHR merges: " << m_num_mshr_merges << "\n";
+    std::cout << "number of MSHR full stalls: " << m_num_mshr_full_stalls << "\n";
+  }
+
+  if (m_prefetcher.is_enabled()) m_prefetcher.print_stats();
+
+  for (int ii = 0; ii < get_num_sources(); ++ii) {
+    std::cout << "number of accesses from core " << ii << ": " << get_source_accesses(ii) << "\n";
+    std::cout << "number of hits from core " << ii << ": " << get_source_hits(ii) << "\n";
+  }
+  if (m_partition.is_enabled()) m_partition.print_stats();
+  // without l2_inclusion in the config, the output stays as before
+  if (m_level == MEM_L2 && m_report_inclusion) print_inclusion_stats();
+
+  print_sampling_stats();
+}
+
+/**
+ * Inclusion victims are demand misses in the L1s to lines an inclusive L2
+ * back-invalidated.  The effective capacity is the data held by this cache
+ * and the caches above it without counting a line twice, at the end of the
+ * run, out of their combined size.
+ */
+void cache_c::print_inclusion_stats() {
+  counter num_backinvals = 0, num_victims = 0;
+  std::vector<cache_c*> uppers(m_uppers_i);
+  uppers.insert(uppers.end(), m_uppers_d.begin(), m_uppers_d.end());
+  for (cache_c* upper : uppers) {
+    if (!upper) continue;
+    num_backinvals += upper->m_num_backinvals;
+    num_victims += upper->m_num_inclusion_victims;
+  }
+
+  std::cout << "inclusion policy: " << inclusion_name(m_inclusion) << "\n";
+  std::cout << "number of back-invalidated lines: " << num_backinvals << "\n";
+  std::cout << "number of inclusion victims: " << num_victims << "\n";
+  if (is_exclusive()) {
+    std::cout << "number of victim fills: " << m_num_victim_fills
+              << " (" << m_num_clean_victim_fills << " clean)\n";
+    std::cout << "number of lines moved up: " << m_num_moved_up << "\n";
+    if (m_directory) std::cout << "number of L1-to-L1 transfers: " << m_num_peer_transfers << "\n";
+  }
+
+  std::vector<addr_t> lines;
+  get_valid_lines(&lines);
+  const std::unordered_set<addr_t> held(lines.begin(), lines.end());
+  uint64_t bytes = held.size() * get_line_size();
+  uint64_t total = (uint64_t)get_num_sets() * get_assoc() * get_line_size();
+
+  std::unordered_set<addr_t> upper_held;    // byte addresses of upper lines not held here
+  for (cache_c* upper : uppers) {
+    if (!upper) continue;
+    total += (uint64_t)upper->get_num_sets() * upper->get_assoc() * upper->get_line_size();
+    lines.clear();
+    upper->get_valid_lines(&lines);
+    for (addr_t line : lines) {
+      const addr_t addr = line * upper->get_line_size();
+      if (!held.count(get_line_addr(addr)) && upper_held.insert(addr).second)
+        bytes += upper->get_line_size();
+    }
+  }
+  std::cout << "effective capacity: " << bytes / 1024.0 << " KB of " << total / 1024.0
+            << " KB (" << (double)bytes / total * 100 << " %)\n";
+}
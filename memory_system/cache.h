@@ -6,46 +6,120 @@
 
 #include "atom/global.h"
 #include "atom/queue.h"
+#include "atom/ready_queue.h"
 #include "atom/mem_req.h"
+#include "atom/mem_req_pool.h"
 #include "./cache_base/cache_base.h"
-#include "memory_controller/simple_mem.h"
+#include "memory_controller/main_memory.h"
 #include "memory_hierarchy.h"
+#include "mshr.h"
+#include "prefetcher.h"
+#include "directory.h"
+#include "partition.h"
 
 #include <cstring>
-#include <functional>
+#include <vector>
 
 // forward declaration
-class simple_mem_c;
+class main_memory_c;
 class memory_hierarchy_c;
+class cache_c;
+
+/**
+ * Where a top-level cache sends the requests it completes.  The target is a
+ * small tagged struct fixed when the hierarchy is wired up, so completing a
+ * request is a switch and a direct call rather than an indirect call through
+ * a std::function binder.
+ */
+struct done_target_s {
+  enum kind_e {
+    NONE = 0,           ///< not connected
+    HIERARCHY,          ///< memory_hierarchy_c::push_done_req (data back to the core)
+  };
+
+  kind_e m_kind;
+  memory_hierarchy_c* m_mm;
+
+  done_target_s() : m_kind(NONE), m_mm(nullptr) {}
+  explicit done_target_s(memory_hierarchy_c* mm) : m_kind(HIERARCHY), m_mm(mm) {}
+
+  explicit operator bool() const { return m_kind != NONE; }
+};
+
+
+/**
+ * How an L2 keeps the lines of the L1s above it (see cache_c::set_inclusion)
+ */
+enum inclusion_e {
+  INCL_INCLUSIVE = 0, ///< every L1 line is also here; an eviction back-invalidates the L1s (default)
+  INCL_NINE,          ///< non-inclusive non-exclusive: misses fill both, evictions leave the L1s alone
+  INCL_EXCLUSIVE,     ///< a line is in the L1s or here: hits move up, L1 victims fill this cache
+  INCL_LAST
+};
+
+int         parse_inclusion(const std::string& name);  ///< inclusion for a config name, -1 if unknown
+const char* inclusion_name(int type);
 
 
 class cache_c : public cache_base_c {
 
 public:
-  cache_c(std::string name, int level, int num_set, int assoc, int line_size, int latency);
-  void configure_neighbors(cache_c* prev_i, cache_c* prev_d, cache_c* next, simple_mem_c* memory);
+  cache_c(std::string name, int level, int num_set, int assoc, int line_size, int latency,
+          int repl_policy = REPL_LRU, uint64_t repl_seed = 1, bool sparse = false);
+  void configure_neighbors(cache_c* prev_i, cache_c* prev_d, cache_c* next, main_memory_c* memory);
+  void add_upper_core(cache_c* prev_i, cache_c* prev_d);  ///< shared level: L1s of the next core
+  void set_core_id(int core_id) { m_core_id = core_id; }
+  /// MESI directory: "id" is the sharer id of a private L1, -1 for the shared level holding it
+  void set_directory(directory_c* directory, int id) { m_directory = directory; m_coh_id = id; }
+  void set_req_pool(mem_req_pool_c* pool) { m_req_pool = pool; }  ///< where write-backs come from
+  void configure_mshr(int num_entries, int num_targets);           ///< 0 entries: no MSHRs
+  void configure_prefetcher(int type, int degree, int distance, bool throttle);  ///< PREF_NONE: off
+  /// shared level: way partitioning among the cores (PART_NONE: off)
+  void configure_partition(int type, const std::string& ways, counter interval);
+  /// L2: inclusion_e; "report": print the inclusion stats
+  void set_inclusion(int inclusion, bool report) { m_inclusion = inclusion; m_report_inclusion = report; }
+  bool is_exclusive() const { return m_inclusion == INCL_EXCLUSIVE; }
+  void track_inclusion_victims(); ///< L1: count demand misses to back-invalidated lines
   void run_a_cycle();             ///< tick a cycle
+  counter get_next_event_cycle() const;     ///< earliest cycle with work to do (MAX_CYCLE: idle)
+  void skip_cycles(counter num_cycles);     ///< fast-forward idle cycles
                                   
   bool access(mem_req_s*);        ///< insert a request into in_queue
   bool fill(mem_req_s*);          ///< insert a request into fill_queue
+  /// functional access: tag stores only, no queues or timing
+  bool warm(addr_t addr, int type, bool* moved_dirty = nullptr);
   
   void print_stats(void);
+  void print_ext_stats();         ///< statistics of the features added to the base cache
 
-  // callback for done requests
+  // target for done requests
 public:
-  using callback_t = std::function<void(mem_req_s*)>;
-
-  callback_t done_func;              
-  void set_done_func(callback_t cb) { done_func = std::move(cb); }
+  void set_done_target(done_target_s target) { m_done_target = target; }
 
 private:
   void process_in_queue();        ///< process requests from in_queue
   void process_out_queue();       ///< process requests from out_queue
   void process_fill_queue();      ///< process requests from fill_queue
   void process_wb_queue();        ///< process requests from wb_queue
+  void process_coh_queue();       ///< send up hits that waited for a coherence intervention
+  bool send_down(ready_queue_c* queue);  ///< ready requests to the next level; false on back-pressure
+  void issue_prefetches(int core_id);  ///< queue the prefetches in m_pf_addrs (for "core_id")
+  void send_miss(mem_req_s* req); ///< miss (or upgrade) to the next level, with an MSHR entry
+  void send_up(mem_req_s* req);   ///< data for "req" to the upper level (or done)
+  void evict_victim(addr_t ev_addr, bool ev_dirty, bool by_prefetch);  ///< inclusion, directory, write-back
+  void back_invalidate(addr_t ev_addr);  ///< inclusive L2: the upper levels lose the line too
+  void record_backinval(addr_t addr);    ///< L1: "addr" was back-invalidated
+  void move_up(mem_req_s* req);   ///< exclusive L2: the line of a hit leaves for the L1
+  bool needs_upgrade(const mem_req_s* req) const;  ///< store to a line this L1 holds shared
+  void push_wb_req(addr_t addr, bool dirty = true);  ///< write-back for a victim (clean: to an exclusive L2)
+  void complete(mem_req_s* req);  ///< hand a done request to m_done_target
+  void release_mshr(mem_req_s* req);  ///< send the requests merged onto a filled miss
+  void warm_victim(addr_t ev_addr, bool ev_dirty);  ///< functional back-invalidation/write-back
+  void print_inclusion_stats();   ///< L2: inclusion policy, victims and effective capacity
 
 public:
-  queue_c* m_in_flight_wb_queue;  ///< in-flight write-back queue
+  /// no write-back inside this cache and none of its prefetches in flight
+  bool is_wb_done() const { return m_num_in_flight_wbs == 0 && m_num_in_flight_pfs == 0; }
 
 private:
   memory_hierarchy_c* m_mm;
@@ -54,21 +128,53 @@ private:
   int m_level;                    ///< cache level (L1, L2) 
   int m_latency;                  ///< cache hit latency (intrinsic access time)
   
-  queue_c* m_in_queue;            ///< input queue 
-  queue_c* m_out_queue;           ///< out queue 
-  queue_c* m_fill_queue;          ///< fill queue 
-  queue_c* m_wb_queue;            ///< write-back queue
+  ready_queue_c* m_in_queue;      ///< input queue 
+  ready_queue_c* m_out_queue;     ///< out queue 
+  ready_queue_c* m_fill_queue;    ///< fill queue 
+  ready_queue_c* m_wb_queue;      ///< write-back queue
+  counter m_num_in_flight_wbs;    ///< write-backs queued in this cache (created or received)
 
   counter m_cycle;                ///< clock cycle                         
 
   cache_c* m_prev_i;              ///< previous I-cache level pointer
   cache_c* m_prev_d;              ///< previous D-cache level pointer
+  std::vector<cache_c*> m_uppers_i;  ///< previous I-cache level of each core (multicore)
+  std::vector<cache_c*> m_uppers_d;  ///< previous D-cache level of each core (multicore)
   cache_c* m_next;                ///< next cache level potiner
-  simple_mem_c* m_memory;         ///< main memory pointer
+  main_memory_c* m_memory;        ///< main memory pointer
+  mem_req_pool_c* m_req_pool;     ///< request pool owned by the memory hierarchy
+  done_target_s m_done_target;    ///< where done requests go (top-level cache only)
   
   int m_num_backinvals;                ///< # of back-invalidations
   int m_num_writebacks_backinval;      ///< # of writebacks due to back-invalidation
 
+  int     m_inclusion;                 ///< L2: inclusion_e toward the L1s
+  bool    m_report_inclusion;          ///< L2: l2_inclusion was configured, print its stats
+  std::vector<addr_t> m_backinval_lines;  ///< L1: back-invalidated lines (direct mapped, line + 1)
+  counter m_num_inclusion_victims;     ///< L1: demand misses to a back-invalidated line
+  counter m_num_victim_fills;          ///< exclusive L2: L1 victims installed
+  counter m_num_clean_victim_fills;    ///< ... of which clean
+  counter m_num_moved_up;              ///< exclusive L2: hit lines handed to an L1
+  counter m_num_peer_transfers;        ///< exclusive L2: misses another core's L1 supplied
+
+  mshr_c  m_mshr;                      ///< miss status holding registers
+  counter m_mshr_occupancy;            ///< sum of valid MSHR entries over cycles
+  int     m_mshr_max_occupancy;        ///< peak valid MSHR entries
+  counter m_num_mshr_merges;           ///< # of secondary misses merged onto an outstanding miss
+  counter m_num_mshr_full_stalls;      ///< # of cycles the in_queue stalled on a full MSHR (entry)
+
+  static const int PF_QUEUE_SIZE = 32; ///< prefetches waiting to go down (more are dropped)
+  prefetcher_c   m_prefetcher;         ///< hardware prefetcher (disabled by default)
+  ready_queue_c* m_pf_queue;           ///< prefetches waiting for the next level (low priority)
+  std::vector<addr_t> m_pf_addrs;      ///< lines the prefetcher asked for on this lookup
+  counter m_num_in_flight_pfs;         ///< prefetches issued by this cache and not filled yet
+
+  int            m_core_id;            ///< core of a private cache (0 with a single core)
+  directory_c*   m_directory;          ///< MESI directory (nullptr: single core)
+  int            m_coh_id;             ///< sharer id in m_directory (-1: the shared level)
+  ready_queue_c* m_coh_queue;          ///< shared level: hits waiting for remote L1s
+  partition_c    m_partition;          ///< shared level: ways of each core (disabled by default)
+
 public:
   cache_c();               // no need to implement
   ~cache_c();
@@ -0,0 +1,119 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "directory.h"
+#include "cache.h"
+
+#include <iostream>
+
+directory_c::directory_c(int line_size, int latency) {
+  m_line_shift = 0;
+  while ((1 << m_line_shift) < line_size) ++m_line_shift;
+  m_latency = latency;
+
+  m_num_reads = 0;
+  m_num_writes = 0;
+  m_num_upgrades = 0;
+  m_num_invalidations = 0;
+  m_num_downgrades = 0;
+  m_num_coherence_wbs = 0;
+}
+
+int directory_c::add_cache(cache_c* cache) {
+  m_caches.push_back(cache);
+  m_invals_by_cache.push_back(0);
+  m_downgrades_by_cache.push_back(0);
+  return m_caches.size() - 1;
+}
+
+int directory_c::request(addr_t addr, int id, bool exclusive, bool* dirty) {
+  const uint64_t bit = 1ULL << id;
+  entry_s& entry = m_entries.emplace(addr >> m_line_shift, entry_s{0, -1}).first->second;
+  int num_remote = 0;
+  *dirty = false;
+
+  if (exclusive) {
+    ++m_num_writes;
+    if ((entry.m_sharers & bit) && entry.m_owner != id) ++m_num_upgrades;
+
+    // invalidate every other copy
+    uint64_t others = entry.m_sharers & ~bit;
+    for (int ii = 0; others; ++ii, others >>= 1) {
+      if (!(others & 1)) continue;
+      bool was_dirty = false;
+      m_caches[ii]->invalidate(addr, &was_dirty);
+      if (was_dirty) {
+        ++m_num_coherence_wbs;
+        *dirty = true;
+      }
+      ++m_num_invalidations;
+      ++m_invals_by_cache[ii];
+      ++num_remote;
+    }
+    entry.m_sharers = bit;
+    entry.m_owner = id;
+    return num_remote;
+  }
+
+  ++m_num_reads;
+  if (entry.m_owner >= 0 && entry.m_owner != id) {
+    // the E/M copy drops to S; modified data goes to the L2
+    if (m_caches[entry.m_owner]->clean(addr)) {
+      ++m_num_coherence_wbs;
+      *dirty = true;
+    }
+    ++m_num_downgrades;
+    ++m_downgrades_by_cache[entry.m_owner];
+    ++num_remote;
+    entry.m_owner = -1;
+  }
+  entry.m_sharers |= bit;
+  if (entry.m_sharers == bit) entry.m_owner = id;     // the only copy: E
+  return num_remote;
+}
+
+bool directory_c::is_exclusive(addr_t addr, int id) const {
+  auto it = m_entries.find(addr >> m_line_shift);
+  return it != m_entries.end() && it->second.m_owner == id;
+}
+
+bool directory_c::has_other_copy(addr_t addr, int id) const {
+  auto it = m_entries.find(addr >> m_line_shift);
+  return it != m_entries.end() && (it->second.m_sharers & ~(1ULL << id));
+}
+
+void directory_c::evict(addr_t addr, int id) {
+  auto it = m_entries.find(addr >> m_line_shift);
+  if (it == m_entries.end()) return;
+
+  it->second.m_sharers &= ~(1ULL << id);
+  if (it->second.m_owner == id) it->second.m_owner = -1;
+  if (!it->second.m_sharers) m_entries.erase(it);
+}
+
+void directory_c::remove(addr_t addr) {
+  m_entries.erase(addr >> m_line_shift);
+}
+
+/**
+ * Coherence messages count the requests, the invalidations and downgrades
+ * they caused, and the data write-backs those returned.
+ */
+void directory_c::print_stats() {
+  std::cout << "------------------------------" << "\n";
+  std::cout << "Coherence Stats (MESI directory)" << "\n";
+  std::cout << "------------------------------" << "\n";
+  std::cout << "number of read requests: "        << m_num_reads << "\n";
+  std::cout << "number of exclusive requests: "   << m_num_writes << "\n";
+  std::cout << "number of upgrades: "             << m_num_upgrades << "\n";
+  std::cout << "number of invalidations: "        << m_num_invalidations << "\n";
+  std::cout << "number of downgrades: "           << m_num_downgrades << "\n";
+  std::cout << "number of coherence write-backs: " << m_num_coherence_wbs << "\n";
+  std::cout << "number of coherence messages: "
+            << m_num_reads + m_num_writes + m_num_invalidations + m_num_downgrades + m_num_coherence_wbs
+            << "\n";
+  for (size_t ii = 0; ii < m_caches.size(); ++ii) {
+    std::cout << m_caches[ii]->get_name() << " invalidations: " << m_invals_by_cache[ii]
+              << ", downgrades: " << m_downgrades_by_cache[ii] << "\n";
+  }
+}
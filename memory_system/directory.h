@@ -0,0 +1,78 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __DIRECTORY_H__
+#define __DIRECTORY_H__
+
+#include "atom/global.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// forward declaration
+class cache_c;
+
+/***
+ *
+ * @class coherence directory (directory_c)
+ *
+ * MESI directory for the private L1s of a multicore hierarchy, kept next to
+ * the shared (inclusive) L2.  For every line held by some L1 it records the
+ * sharers and, if one L1 has it exclusively, the owner.  The state of a line
+ * in an L1 follows from the directory and the L1's dirty bit:
+ *
+ *   M : owner, dirty        E : owner, clean
+ *   S : sharer, not owner   I : not a sharer
+ *
+ * Requests are resolved when they look up the L2: a read makes the owner (if
+ * any) write its data back and drop to S, and a write (read-for-ownership or
+ * upgrade) invalidates every other copy.  The remote caches are updated right
+ * away, like inclusion back-invalidations, and the L2 delays the answer by
+ * the coherence latency instead.  There are no transient states.
+ */
+class directory_c {
+public:
+  static const int MAX_CACHES = 64;          ///< sharers are a 64-bit vector
+
+  directory_c(int line_size, int latency);
+
+  int add_cache(cache_c* cache);             ///< register an L1; returns its sharer id
+
+  /**
+   * Give cache "id" a copy of the line of "addr" (exclusive: for a write).
+   * Returns the number of other caches that had to be invalidated or
+   * downgraded; "*dirty" is set if one of them held modified data.
+   */
+  int  request(addr_t addr, int id, bool exclusive, bool* dirty);
+  bool is_exclusive(addr_t addr, int id) const;   ///< E or M in cache "id"
+  bool has_other_copy(addr_t addr, int id) const; ///< a cache other than "id" holds the line
+  void evict(addr_t addr, int id);           ///< cache "id" dropped the line
+  void remove(addr_t addr);                  ///< the L2 evicted the line (back-invalidated)
+
+  int  get_latency() const { return m_latency; }
+  void print_stats();
+
+private:
+  struct entry_s {
+    uint64_t m_sharers;                      ///< bit per cache holding the line
+    int      m_owner;                        ///< cache with E/M (-1: none)
+  };
+
+  int m_line_shift;
+  int m_latency;                             ///< cycles an intervention adds to a request
+
+  std::vector<cache_c*> m_caches;
+  std::unordered_map<addr_t, entry_s> m_entries;   ///< by line address
+
+  counter m_num_reads;                       ///< read requests
+  counter m_num_writes;                      ///< read-for-ownership requests and upgrades
+  counter m_num_upgrades;                    ///< writes from a cache that already had a shared copy
+  counter m_num_invalidations;
+  counter m_num_downgrades;                  ///< E/M copies dropped to S by a read
+  counter m_num_coherence_wbs;               ///< modified data written back to the L2
+  std::vector<counter> m_invals_by_cache;
+  std::vector<counter> m_downgrades_by_cache;
+};
+
+#endif // !__DIRECTORY_H__
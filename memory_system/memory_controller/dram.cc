@@ -0,0 +1,220 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "dram.h"
+#include "memory_system/cache.h"
+#include "memory_system/memory_hierarchy.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+static int log2_int(int v) {
+  int shift = 0;
+  while (v > 1) { v >>= 1; ++shift; }
+  return shift;
+}
+
+dram_c::dram_c(const std::string& name, const dram_config_s& config)
+    : m_name(name), m_config(config), m_cycle(0), m_channels(config.num_channels) {
+  for (channel_s& channel : m_channels) {
+    channel.m_banks.resize(config.num_ranks * config.num_banks);
+    for (bank_s& bank : channel.m_banks) {
+      bank.m_open_row = -1;
+      bank.m_rdy_cycle = 0;
+    }
+    channel.m_bus_free = 0;
+  }
+
+  m_out_queue = new ready_queue_c();
+  m_prev = nullptr;
+  m_mm = nullptr;
+  m_num_in_flight_wbs = 0;
+
+  m_num_reads = 0;
+  m_num_writes = 0;
+  m_num_row_hits = 0;
+  m_num_row_misses = 0;
+  m_num_row_conflicts = 0;
+  m_queue_delay = 0;
+  m_access_latency = 0;
+  m_num_queue_overflows = 0;
+
+  m_bits[CHANNEL] = log2_int(config.num_channels);
+  m_bits[RANK]    = log2_int(config.num_ranks);
+  m_bits[BANK]    = log2_int(config.num_banks);
+  m_bits[COLUMN]  = log2_int(config.row_size / LINE_SIZE);
+  m_bits[ROW]     = 0;
+  std::fill(m_shift, m_shift + NUM_FIELDS, 0);
+}
+
+dram_c::~dram_c() {
+  delete m_out_queue;
+}
+
+/**
+ * Lay the fields out above the line offset, least significant last in "map".
+ * The row is always the most significant field and takes the remaining bits.
+ */
+bool dram_c::set_address_map(const std::string& map) {
+  static const char* names[NUM_FIELDS] = {"channel", "rank", "bank", "row", "column"};
+
+  std::vector<int> order;
+  std::stringstream ss(map);
+  std::string field;
+  while (std::getline(ss, field, ':')) {
+    int found = -1;
+    for (int ii = 0; ii < NUM_FIELDS; ++ii) {
+      if (field == names[ii]) found = ii;
+    }
+    if (found < 0 || std::find(order.begin(), order.end(), found) != order.end()) return false;
+    order.push_back(found);
+  }
+  if (order.size() != NUM_FIELDS || order.front() != ROW) return false;
+
+  int shift = log2_int(LINE_SIZE);
+  for (auto it = order.rbegin(); it != order.rend(); ++it) {
+    m_shift[*it] = shift;
+    shift += m_bits[*it];
+  }
+  m_bits[ROW] = 64 - m_shift[ROW];
+  return true;
+}
+
+/**
+ * Queue a request at its channel; there is no latency until it is issued.
+ * The core does not retry a refused request, so a full queue never refuses
+ * one: the overflow waits behind the queue in arrival order instead.
+ */
+bool dram_c::access(mem_req_s* req) {
+  auto field = [&](int ff) { return (int)((req->m_addr >> m_shift[ff]) & ((1ull << m_bits[ff]) - 1)); };
+
+  channel_s& channel = m_channels[field(CHANNEL)];
+  if (m_config.queue_size && channel.m_queue.size() >= (size_t)m_config.queue_size)
+    ++m_num_queue_overflows;
+
+  entry_s entry;
+  entry.m_req     = req;
+  entry.m_arrival = m_cycle;
+  entry.m_bank    = field(RANK) * m_config.num_banks + field(BANK);
+  entry.m_row     = req->m_addr >> m_shift[ROW];
+  channel.m_queue.push_back(entry);
+
+  if (req->m_type == REQ_WB || req->m_type == REQ_DSTORE) ++m_num_writes;
+  else ++m_num_reads;
+  if (req->m_type == REQ_WB) ++m_num_in_flight_wbs;
+  return true;
+}
+
+/**
+ * Return the data that is ready, then let every channel issue a request.
+ */
+void dram_c::run_a_cycle() {
+  while (mem_req_s* req = m_out_queue->peek_ready(m_cycle)) {
+    m_out_queue->pop();
+    complete(req);
+  }
+
+  for (channel_s& channel : m_channels) schedule(&channel);
+
+  ++m_cycle;
+}
+
+/**
+ * FR-FCFS: the oldest row hit among the queued requests whose bank can take
+ * a command this cycle, or failing that the oldest of them.
+ */
+void dram_c::schedule(channel_s* channel) {
+  std::deque<entry_s>& queue = channel->m_queue;
+  const size_t window = get_window(*channel);
+
+  int pick = -1;
+  for (size_t ii = 0; ii < window; ++ii) {
+    const bank_s& bank = channel->m_banks[queue[ii].m_bank];
+    if (bank.m_rdy_cycle > m_cycle) continue;
+    if (bank.m_open_row == queue[ii].m_row) {
+      pick = ii;
+      break;
+    }
+    if (pick < 0) pick = ii;
+  }
+  if (pick < 0) return;
+
+  entry_s entry = queue[pick];
+  queue.erase(queue.begin() + pick);
+  bank_s& bank = channel->m_banks[entry.m_bank];
+
+  // cycles before the column command can go out
+  counter prep;
+  if (bank.m_open_row == entry.m_row) {
+    prep = 0;
+    ++m_num_row_hits;
+  } else if (bank.m_open_row < 0) {
+    prep = m_config.tRCD;
+    ++m_num_row_misses;
+  } else {
+    prep = m_config.tRP + m_config.tRCD;
+    ++m_num_row_conflicts;
+  }
+
+  counter data = std::max(m_cycle + prep + m_config.tCAS, channel->m_bus_free);
+  channel->m_bus_free = data + m_config.tBURST;
+
+  // the next column command to an open row can follow one burst later
+  bank.m_rdy_cycle = m_cycle + prep + m_config.tBURST;
+  if (m_config.closed_page) {
+    bank.m_open_row = -1;
+    bank.m_rdy_cycle += m_config.tRP;
+  } else {
+    bank.m_open_row = entry.m_row;
+  }
+
+  m_queue_delay += m_cycle - entry.m_arrival;
+  m_access_latency += channel->m_bus_free - entry.m_arrival;
+
+  entry.m_req->m_rdy_cycle = channel->m_bus_free;
+  m_out_queue->push(entry.m_req);
+}
+
+void dram_c::complete(mem_req_s* req) {
+  if (req->m_type == REQ_WB) {
+    --m_num_in_flight_wbs;
+    delete req;
+  } else if (m_prev) {
+    m_prev->fill(req);
+  } else {
+    m_mm->push_done_req(req);
+  }
+}
+
+/**
+ * A queued request can issue once its bank is ready, and an issued one
+ * completes at its ready cycle.  Requests behind the scheduler window wait
+ * for one in the window to issue, so only the window is checked.
+ */
+counter dram_c::get_next_event_cycle() const {
+  counter next = m_out_queue->get_earliest_rdy_cycle();
+  for (const channel_s& channel : m_channels) {
+    const size_t window = get_window(channel);
+    for (size_t ii = 0; ii < window; ++ii) {
+      const bank_s& bank = channel.m_banks[channel.m_queue[ii].m_bank];
+      next = std::min(next, std::max(m_cycle, bank.m_rdy_cycle));
+    }
+  }
+  return next;
+}
+
+void dram_c::print_stats() {
+  const counter accesses = m_num_row_hits + m_num_row_misses + m_num_row_conflicts;
+  std::cout << "------------------------------" << "\n";
+  std::cout << m_name << " Row Hit Rate: "       << (double)m_num_row_hits/accesses*100 << " % \n";
+  std::cout << "------------------------------" << "\n";
+  std::cout << "number of reads: "          << m_num_reads << "\n";
+  std::cout << "number of writes: "         << m_num_writes << "\n";
+  std::cout << "number of row hits: "       << m_num_row_hits << "\n";
+  std::cout << "number of row misses: "     << m_num_row_misses << "\n";
+  std::cout << "number of bank conflicts: " << m_num_row_conflicts << "\n";
+  std::cout << "average queueing delay: "   << (double)m_queue_delay/accesses << "\n";
+  std::cout << "average access latency: "   << (double)m_access_latency/accesses << "\n";
+  std::cout << "number of queue overflows: " << m_num_queue_overflows << "\n";
+}
@@ -0,0 +1,132 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __DRAM_H__
+#define __DRAM_H__
+
+#include "atom/mem_req.h"
+#include "atom/global.h"
+#include "atom/ready_queue.h"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+// forward declaration
+class cache_c;
+class memory_hierarchy_c;
+
+/// DRAM geometry, timing and policies (timings are in memory-hierarchy cycles)
+struct dram_config_s {
+  int num_channels;
+  int num_ranks;                ///< ranks per channel
+  int num_banks;                ///< banks per rank
+  int row_size;                 ///< bytes per row of a bank
+  std::string address_map;      ///< see dram_c::set_address_map()
+  bool closed_page;             ///< precharge after every access (false: open page)
+  int tRCD;                     ///< activate to column command
+  int tCAS;                     ///< column command to data
+  int tRP;                      ///< precharge to activate
+  int tBURST;                   ///< data transfer of one line on the channel bus
+  int queue_size;               ///< requests per channel the scheduler picks from (0: all)
+};
+
+/**
+ * @class dram_c
+ *
+ * A banked DRAM controller that can stand in for simple_mem_c.  Requests are
+ * mapped to a channel, rank, bank, row and column by the address map and wait
+ * in a per-channel queue.  Every cycle each channel issues at most one of its
+ * queue_size oldest requests, picked first-ready, first-come-first-served
+ * (FR-FCFS): the oldest request that hits the open row of an idle bank, else
+ * the oldest request to an idle bank.  The access costs tCAS on a row hit, tRCD + tCAS on a closed
+ * bank, and tRP + tRCD + tCAS on a bank conflict (another row open), and its
+ * line then takes tBURST on the channel's data bus.  With the closed-page
+ * policy a bank precharges right after each access, so every access pays
+ * tRCD + tCAS, and tRP only delays one that arrives at a busy bank.
+ *
+ * Like simple_mem_c, the data goes back to the previous level cache (or to
+ * the memory hierarchy if there is none), and write-backs are deleted once
+ * they are written.
+ */
+class dram_c {
+public:
+  dram_c(const std::string& name, const dram_config_s& config);
+  ~dram_c();
+
+  /// fields from most to least significant, e.g. "row:rank:bank:channel:column";
+  /// returns false if a field is missing, repeated or unknown
+  bool set_address_map(const std::string& map);
+
+  void run_a_cycle();
+  bool access(mem_req_s* req);               ///< always accepts (see access())
+  void configure_neighbors(cache_c* prev) { m_prev = prev; }
+  void set_done_target(memory_hierarchy_c* mm) { m_mm = mm; }  ///< used without a previous cache
+  const std::string& get_name() { return m_name; }
+
+  counter get_next_event_cycle() const;      ///< earliest cycle with work to do (MAX_CYCLE: idle)
+  void skip_cycles(counter num_cycles) { m_cycle += num_cycles; }  ///< fast-forward idle cycles
+  bool is_wb_done() const { return m_num_in_flight_wbs == 0; }
+
+  void print_stats();
+
+  /// the line size the address map assumes below the column field
+  static const int LINE_SIZE = 64;
+
+private:
+  dram_c(const dram_c&);                     // not copyable
+  dram_c& operator=(const dram_c&);
+
+  enum field_e { CHANNEL = 0, RANK, BANK, ROW, COLUMN, NUM_FIELDS };
+
+  struct bank_s {
+    int64_t m_open_row;                      ///< -1: precharged
+    counter m_rdy_cycle;                     ///< earliest cycle of the next command
+  };
+
+  struct entry_s {
+    mem_req_s* m_req;
+    counter    m_arrival;                    ///< cycle the request entered the queue
+    int        m_bank;                       ///< bank index within the channel
+    int64_t    m_row;
+  };
+
+  struct channel_s {
+    std::vector<bank_s>  m_banks;            ///< rank-major
+    std::deque<entry_s>  m_queue;            ///< oldest first; the scheduler sees queue_size of them
+    counter m_bus_free;                      ///< data bus is busy until this cycle
+  };
+
+  /// queued requests the scheduler picks from: the oldest queue_size
+  size_t get_window(const channel_s& channel) const {
+    const size_t size = channel.m_queue.size();
+    return (m_config.queue_size && size > (size_t)m_config.queue_size) ? m_config.queue_size : size;
+  }
+
+  void schedule(channel_s* channel);         ///< issue one request (FR-FCFS)
+  void complete(mem_req_s* req);             ///< data returned or write-back written
+
+  std::string   m_name;
+  dram_config_s m_config;
+  counter       m_cycle;
+
+  int m_shift[NUM_FIELDS];                   ///< address bit position of each field
+  int m_bits[NUM_FIELDS];                    ///< address bits of each field
+
+  std::vector<channel_s> m_channels;
+  ready_queue_c* m_out_queue;                ///< issued requests, ready at their data cycle
+  cache_c* m_prev;                           ///< previous level cache pointer
+  memory_hierarchy_c* m_mm;                  ///< done requests go here without a previous cache
+  counter m_num_in_flight_wbs;               ///< write-backs accepted but not written yet
+
+  counter m_num_reads;
+  counter m_num_writes;
+  counter m_num_row_hits;                    ///< open row matched
+  counter m_num_row_misses;                  ///< bank precharged
+  counter m_num_row_conflicts;               ///< another row open
+  counter m_queue_delay;                     ///< sum of cycles from arrival to issue
+  counter m_access_latency;                  ///< sum of cycles from arrival to data
+  counter m_num_queue_overflows;            ///< requests that arrived at a full channel queue
+};
+
+#endif // !__DRAM_H__
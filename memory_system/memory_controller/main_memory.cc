@@ -0,0 +1,120 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "main_memory.h"
+#include "dram.h"
+#include "simple_mem.h"
+#include "config.h"
+#include "memory_system/memory_hierarchy.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+static bool is_pow2(int v) { return v > 0 && (v & (v - 1)) == 0; }
+
+main_memory_c::main_memory_c(const config_c& cfg) {
+  if (cfg.get_dram_model() == "simple") {
+    m_model = SIMPLE;
+    m_simple = new simple_mem_c("DRAM", MEM_MC, cfg.get_memory_latency());
+    return;
+  }
+  if (cfg.get_dram_model() != "banked") {
+    fprintf(stderr, "[Error]: unknown dram_model %s\n", cfg.get_dram_model().c_str());
+    exit(1);
+  }
+
+  dram_config_s config;
+  config.num_channels = cfg.get_dram_channels();
+  config.num_ranks    = cfg.get_dram_ranks();
+  config.num_banks    = cfg.get_dram_banks();
+  config.row_size     = cfg.get_dram_row_size();
+  config.address_map  = cfg.get_dram_address_map();
+  config.closed_page  = (cfg.get_dram_page_policy() == "closed");
+  config.tRCD         = cfg.get_dram_trcd();
+  config.tCAS         = cfg.get_dram_tcas();
+  config.tRP          = cfg.get_dram_trp();
+  config.tBURST       = cfg.get_dram_tburst();
+  config.queue_size   = cfg.get_dram_queue_size();
+
+  // the address map slices the address with shifts and masks
+  if (!is_pow2(config.num_channels) || !is_pow2(config.num_ranks) || !is_pow2(config.num_banks) ||
+      !is_pow2(config.row_size) || config.row_size < dram_c::LINE_SIZE) {
+    fprintf(stderr, "[Error]: DRAM channels, ranks, banks and row size must be powers of two\n");
+    exit(1);
+  }
+  if (!config.closed_page && cfg.get_dram_page_policy() != "open") {
+    fprintf(stderr, "[Error]: unknown dram_page_policy %s\n", cfg.get_dram_page_policy().c_str());
+    exit(1);
+  }
+
+  m_model = BANKED;
+  m_banked = new dram_c("DRAM", config);
+  if (!m_banked->set_address_map(config.address_map)) {
+    fprintf(stderr, "[Error]: bad dram_address_map %s\n", config.address_map.c_str());
+    exit(1);
+  }
+}
+
+main_memory_c::~main_memory_c() {
+  switch (m_model) {
+    case SIMPLE: delete m_simple; break;
+    case BANKED: delete m_banked; break;
+  }
+}
+
+void main_memory_c::configure_neighbors(cache_c* prev, memory_hierarchy_c* mm) {
+  switch (m_model) {
+    case SIMPLE:
+      m_simple->configure_neighbors(prev);
+      // the prebuilt memory controller only takes a std::function; a lambda that
+      // captures just "mm" is stored in place, unlike a std::bind object
+      if (!prev) m_simple->set_done_func([mm](mem_req_s* req) { mm->push_done_req(req); });
+      break;
+    case BANKED:
+      m_banked->configure_neighbors(prev);
+      m_banked->set_done_target(mm);
+      break;
+  }
+}
+
+bool main_memory_c::access(mem_req_s* req) {
+  switch (m_model) {
+    case SIMPLE: return m_simple->access(req);
+    case BANKED: return m_banked->access(req);
+  }
+  return false;
+}
+
+void main_memory_c::run_a_cycle() {
+  switch (m_model) {
+    case SIMPLE: m_simple->run_a_cycle(); break;
+    case BANKED: m_banked->run_a_cycle(); break;
+  }
+}
+
+counter main_memory_c::get_next_event_cycle() const {
+  switch (m_model) {
+    case SIMPLE: return m_simple->get_next_event_cycle();
+    case BANKED: return m_banked->get_next_event_cycle();
+  }
+  return MAX_CYCLE;
+}
+
+void main_memory_c::skip_cycles(counter num_cycles) {
+  switch (m_model) {
+    case SIMPLE: m_simple->skip_cycles(num_cycles); break;
+    case BANKED: m_banked->skip_cycles(num_cycles); break;
+  }
+}
+
+bool main_memory_c::is_wb_done() const {
+  switch (m_model) {
+    case SIMPLE: return m_simple->m_in_flight_wb_queue->empty();
+    case BANKED: return m_banked->is_wb_done();
+  }
+  return true;
+}
+
+void main_memory_c::print_stats() {
+  if (m_model == BANKED) m_banked->print_stats();
+}
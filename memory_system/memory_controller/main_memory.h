@@ -0,0 +1,56 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __MAIN_MEMORY_H__
+#define __MAIN_MEMORY_H__
+
+#include "atom/mem_req.h"
+#include "atom/global.h"
+
+// forward declaration
+class cache_c;
+class config_c;
+class dram_c;
+class memory_hierarchy_c;
+class simple_mem_c;
+
+/**
+ * @class main_memory_c
+ *
+ * The main memory of a hierarchy: either the fixed-latency simple_mem_c or
+ * the banked dram_c, chosen by "dram_model".  The prebuilt simple_mem_c
+ * cannot take a virtual base, so like done_target_s this keeps a tag and
+ * every call is a switch and a direct call.
+ */
+class main_memory_c {
+public:
+  enum model_e {
+    SIMPLE = 0,         ///< simple_mem_c: every request takes memory_latency
+    BANKED,             ///< dram_c: channels/ranks/banks with row buffers
+  };
+
+  explicit main_memory_c(const config_c& cfg);   ///< stops the simulation on a bad DRAM config
+  ~main_memory_c();
+
+  /// "prev" gets the data; without one, done requests go to "mm"
+  void configure_neighbors(cache_c* prev, memory_hierarchy_c* mm);
+
+  bool access(mem_req_s* req);
+  void run_a_cycle();
+  counter get_next_event_cycle() const;     ///< earliest cycle with work to do (MAX_CYCLE: idle)
+  void skip_cycles(counter num_cycles);     ///< fast-forward idle cycles
+  bool is_wb_done() const;                  ///< no write-back in flight
+  void print_stats();                       ///< the simple model has no statistics
+
+private:
+  main_memory_c(const main_memory_c&);      // not copyable
+  main_memory_c& operator=(const main_memory_c&);
+
+  model_e m_model;
+  union {
+    simple_mem_c* m_simple;
+    dram_c*       m_banked;
+  };
+};
+
+#endif // !__MAIN_MEMORY_H__
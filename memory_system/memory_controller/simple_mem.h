@@ -18,6 +18,14 @@
 class cache_c;  
 class queue_c;
 
+/// earliest ready cycle among the requests in a queue (MAX_CYCLE if empty)
+inline counter get_earliest_rdy_cycle(const queue_c* queue) {
+  counter rdy = MAX_CYCLE;
+  for (mem_req_s* req : queue->m_entry)
+    if (req->m_rdy_cycle < rdy) rdy = req->m_rdy_cycle;
+  return rdy;
+}
+
 class simple_mem_c {
 public:
   simple_mem_c(const std::string& name, int level, uint32_t latency);
@@ -31,6 +39,14 @@ public:
   void process_in_queue();
   void process_out_queue();
 
+  // earliest cycle at which run_a_cycle() has work to do (MAX_CYCLE: idle);
+  // out_queue entries are handed back on the next tick regardless of ready cycle
+  counter get_next_event_cycle() const {
+    if (!m_out_queue->m_entry.empty()) return m_cycle;
+    return get_earliest_rdy_cycle(m_in_queue);
+  }
+  void skip_cycles(counter num_cycles) { m_cycle += num_cycles; }  ///< fast-forward idle cycles
+
   queue_c* m_in_flight_wb_queue;     // in-flight wb queue
                                      
   // callback for done requests
@@ -13,30 +13,88 @@
 
 #include "memory_hierarchy.h"
 #include "cache.h"
+#include "cache_base/checkpoint_format.h"
 
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
 
-memory_hierarchy_c::memory_hierarchy_c(config_c& config) {
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+memory_hierarchy_c::memory_hierarchy_c(config_c& config, int num_cores) {
 
   m_config = config;
   m_mem_req_id = 0;    // starting unique request id
   m_cycle = 0;         // memory hierarchy cycle
+  m_num_cores = num_cores;
+  m_core_in_flight.assign(num_cores, 0);
 
   m_l1u_cache = nullptr;
-  m_l1i_cache = nullptr;                     
-  m_l1d_cache = nullptr;                     
   m_l2_cache = nullptr;                     
+  m_directory = nullptr;
   m_dram = nullptr;                     
 
-  m_done_queue = new queue_c();
+  m_done_queue = new ready_queue_c();
 
   init(config);
+}
+
+/**
+ * Replacement policy for a config name; unknown names stop the simulation.
+ */
+static int to_repl_policy(const std::string& name) {
+  int policy = parse_repl_policy(name);
+  if (policy < 0) {
+    fprintf(stderr, "[Error]: unknown replacement policy %s\n", name.c_str());
+    exit(1);
+  }
+  if (policy == REPL_OPT) {
+    // OPT needs the next use of every reference (run_base only)
+    fprintf(stderr, "[Error]: opt replacement is only available in run_base\n");
+    exit(1);
+  }
+  return policy;
+}
 
-  // set done requests callback function for children.
-  if (config.get_mem_hierarchy() == static_cast<int>(Hierarchy::DRAM_ONLY)) {
-    assert(m_dram && "main memory is not instantiated");
-    m_dram->set_done_func(std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1)); 
-  } 
+/**
+ * Prefetcher for a config name; unknown names stop the simulation.
+ */
+static int to_prefetcher(const std::string& name) {
+  int type = parse_prefetcher(name);
+  if (type < 0) {
+    fprintf(stderr, "[Error]: unknown prefetcher %s\n", name.c_str());
+    exit(1);
+  }
+  return type;
+}
+
+/**
+ * Partitioning for a config name; unknown names stop the simulation.
+ */
+static int to_partition(const std::string& name) {
+  int type = parse_partition(name);
+  if (type < 0) {
+    fprintf(stderr, "[Error]: unknown partitioning %s\n", name.c_str());
+    exit(1);
+  }
+  return type;
+}
+
+/**
+ * Inclusion policy for a config name; unknown names stop the simulation.
+ */
+static int to_inclusion(const std::string& name) {
+  int type = parse_inclusion(name);
+  if (type < 0) {
+    fprintf(stderr, "[Error]: unknown inclusion policy %s\n", name.c_str());
+    exit(1);
+  }
+  return type;
 }
 
 /**
@@ -51,12 +109,19 @@ void memory_hierarchy_c::init(config_c& cfg) {
   
   // instantiate caches and main memory (e.g., DRAM)
   // DRAM 공통
-  m_dram = new simple_mem_c("DRAM", MEM_MC, cfg.get_memory_latency());
+  m_dram = new main_memory_c(cfg);
+
+  if (m_num_cores > 1 && cfg.get_mem_hierarchy() != static_cast<int>(Hierarchy::MULTI_LEVEL)) {
+    fprintf(stderr, "[Error]: multicore needs the multi-level hierarchy (private L1s, shared L2)\n");
+    exit(1);
+  }
+  if (m_num_cores > directory_c::MAX_CACHES / 2) {
+    fprintf(stderr, "[Error]: at most %d cores\n", directory_c::MAX_CACHES / 2);
+    exit(1);
+  }
 
   if (cfg.get_mem_hierarchy() == static_cast<int>(Hierarchy::DRAM_ONLY)) {
-    m_dram->configure_neighbors(nullptr);
-    m_dram->set_done_func(
-      std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1));
+    m_dram->configure_neighbors(nullptr, this);
     return;
   }
 
@@ -70,58 +135,140 @@ void memory_hierarchy_c::init(config_c& cfg) {
                               num_sets,
                               cfg.get_l1d_assoc(),
                               cfg.get_l1d_line_size(),
-                              cfg.get_l1d_latency());
+                              cfg.get_l1d_latency(),
+                              to_repl_policy(cfg.get_l1d_replacement()),
+                              cfg.get_replacement_seed());
 
     // 위→코어 callback
-    m_l1u_cache->set_done_func(
-      std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1));
+    m_l1u_cache->set_done_target(done_target_s(this));
 
-    // 아래→DRAM callback
-    m_dram->configure_neighbors(m_l1u_cache);
-    m_dram->set_done_func(
-      std::bind(&cache_c::fill, m_l1u_cache, std::placeholders::_1));
+    // 아래→DRAM: main memory fills its configured neighbor directly
+    m_dram->configure_neighbors(m_l1u_cache, this);
 
     // 이웃 연결
     m_l1u_cache->configure_neighbors(nullptr, nullptr, nullptr, m_dram);
+    m_l1u_cache->set_req_pool(&m_req_pool);
+    m_l1u_cache->configure_mshr(cfg.get_mshr_entries(), cfg.get_mshr_targets());
+    m_l1u_cache->set_set_sampling(cfg.get_l1d_set_sampling());
+    m_l1u_cache->configure_prefetcher(to_prefetcher(cfg.get_l1d_prefetcher()),
+                                      cfg.get_prefetch_degree(), cfg.get_prefetch_distance(),
+                                      cfg.is_prefetch_throttle());
+    m_caches.push_back(m_l1u_cache);
     return;
   }
 
-  // ---- MULTI_LEVEL (L1I/L1D + L2) ---- //
+  // ---- MULTI_LEVEL (L1I/L1D per core + shared L2) ---- //
   if (cfg.get_mem_hierarchy() == static_cast<int>(Hierarchy::MULTI_LEVEL)) {
 
     int l1i_sets = cfg.get_l1i_size() / (cfg.get_l1i_assoc() * cfg.get_l1i_line_size());
     int l1d_sets = cfg.get_l1d_size() / (cfg.get_l1d_assoc() * cfg.get_l1d_line_size());
     int l2_sets  = cfg.get_l2_size()  / (cfg.get_l2_assoc()  * cfg.get_l2_line_size());
 
-    m_l1i_cache = new cache_c("L1I", MEM_L1,
-                              l1i_sets,
-                              cfg.get_l1i_assoc(),
-                              cfg.get_l1i_line_size(),
-                              cfg.get_l1i_latency());
-
-    m_l1d_cache = new cache_c("L1D", MEM_L1,
-                              l1d_sets,
-                              cfg.get_l1d_assoc(),
-                              cfg.get_l1d_line_size(),
-                              cfg.get_l1d_latency());
-
     m_l2_cache  = new cache_c("L2", MEM_L2,
                               l2_sets,
                               cfg.get_l2_assoc(),
                               cfg.get_l2_line_size(),
-                              cfg.get_l2_latency());
-
-    // callbacks
-    m_l1i_cache->set_done_func(std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1));
-    m_l1d_cache->set_done_func(std::bind(&memory_hierarchy_c::push_done_req, this, std::placeholders::_1));
-
-    m_dram->configure_neighbors(m_l2_cache);
-    m_dram->set_done_func(std::bind(&cache_c::fill, m_l2_cache, std::placeholders::_1));
-
-    // neighbors
-    m_l2_cache->configure_neighbors(m_l1i_cache, m_l1d_cache, nullptr, m_dram);
-    m_l1i_cache->configure_neighbors(nullptr, nullptr, m_l2_cache, nullptr);
-    m_l1d_cache->configure_neighbors(nullptr, nullptr, m_l2_cache, nullptr);
+                              cfg.get_l2_latency(),
+                              to_repl_policy(cfg.get_l2_replacement()),
+                              cfg.get_replacement_seed(),
+                              cfg.is_l2_sparse());
+
+    m_l2_cache->set_inclusion(to_inclusion(cfg.get_l2_inclusion()), cfg.is_l2_inclusion_set());
+    if (m_l2_cache->is_exclusive() && (cfg.get_l1i_line_size() != cfg.get_l2_line_size() ||
+                                       cfg.get_l1d_line_size() != cfg.get_l2_line_size())) {
+      // lines move between the levels whole
+      fprintf(stderr, "[Error]: an exclusive L2 needs the same line size in the L1s and the L2\n");
+      exit(1);
+    }
+
+    if (m_num_cores > 1) {
+      // the directory tracks whole L2 lines in the L1s
+      if (cfg.get_l1i_line_size() != cfg.get_l2_line_size() ||
+          cfg.get_l1d_line_size() != cfg.get_l2_line_size()) {
+        fprintf(stderr, "[Error]: multicore needs the same line size in the L1s and the L2\n");
+        exit(1);
+      }
+      m_directory = new directory_c(cfg.get_l2_line_size(), cfg.get_coherence_latency());
+      m_l2_cache->set_directory(m_directory, -1);
+    }
+
+    for (int core = 0; core < m_num_cores; ++core) {
+      // a single core keeps the plain names
+      const std::string suffix = (m_num_cores > 1) ? "_" + std::to_string(core) : "";
+
+      cache_c* l1i = new cache_c("L1I" + suffix, MEM_L1,
+                                 l1i_sets,
+                                 cfg.get_l1i_assoc(),
+                                 cfg.get_l1i_line_size(),
+                                 cfg.get_l1i_latency(),
+                                 to_repl_policy(cfg.get_l1i_replacement()),
+                                 cfg.get_replacement_seed());
+
+      cache_c* l1d = new cache_c("L1D" + suffix, MEM_L1,
+                                 l1d_sets,
+                                 cfg.get_l1d_assoc(),
+                                 cfg.get_l1d_line_size(),
+                                 cfg.get_l1d_latency(),
+                                 to_repl_policy(cfg.get_l1d_replacement()),
+                                 cfg.get_replacement_seed());
+      m_l1i_caches.push_back(l1i);
+      m_l1d_caches.push_back(l1d);
+      m_caches.push_back(l1i);
+      m_caches.push_back(l1d);
+
+      // callbacks
+      l1i->set_done_target(done_target_s(this));
+      l1d->set_done_target(done_target_s(this));
+
+      // neighbors
+      if (core == 0)
+        m_l2_cache->configure_neighbors(l1i, l1d, nullptr, m_dram);
+      else
+        m_l2_cache->add_upper_core(l1i, l1d);
+      l1i->configure_neighbors(nullptr, nullptr, m_l2_cache, nullptr);
+      l1d->configure_neighbors(nullptr, nullptr, m_l2_cache, nullptr);
+
+      l1i->set_req_pool(&m_req_pool);
+      l1d->set_req_pool(&m_req_pool);
+
+      l1i->configure_mshr(cfg.get_mshr_entries(), cfg.get_mshr_targets());
+      l1d->configure_mshr(cfg.get_mshr_entries(), cfg.get_mshr_targets());
+
+      l1i->set_set_sampling(cfg.get_l1i_set_sampling());
+      l1d->set_set_sampling(cfg.get_l1d_set_sampling());
+
+      l1i->configure_prefetcher(to_prefetcher(cfg.get_l1i_prefetcher()),
+                                cfg.get_prefetch_degree(), cfg.get_prefetch_distance(),
+                                cfg.is_prefetch_throttle());
+      l1d->configure_prefetcher(to_prefetcher(cfg.get_l1d_prefetcher()),
+                                cfg.get_prefetch_degree(), cfg.get_prefetch_distance(),
+                                cfg.is_prefetch_throttle());
+
+      l1i->set_core_id(core);
+      l1d->set_core_id(core);
+      if (cfg.is_l2_inclusion_set()) {
+        l1i->track_inclusion_victims();
+        l1d->track_inclusion_victims();
+      }
+      if (m_directory) {
+        l1i->set_directory(m_directory, m_directory->add_cache(l1i));
+        l1d->set_directory(m_directory, m_directory->add_cache(l1d));
+      }
+    }
+
+    m_dram->configure_neighbors(m_l2_cache, this);
+
+    m_l2_cache->set_req_pool(&m_req_pool);
+    m_l2_cache->configure_mshr(cfg.get_mshr_entries(), cfg.get_mshr_targets());
+    m_l2_cache->set_set_sampling(cfg.get_l2_set_sampling());
+    m_l2_cache->configure_prefetcher(to_prefetcher(cfg.get_l2_prefetcher()),
+                                     cfg.get_prefetch_degree(), cfg.get_prefetch_distance(),
+                                     cfg.is_prefetch_throttle());
+    if (m_num_cores > 1) {
+      m_l2_cache->configure_partition(to_partition(cfg.get_l2_partition()),
+                                      cfg.get_l2_partition_ways(), cfg.get_ucp_interval());
+    }
+    m_caches.push_back(m_l2_cache);
     return;
   }
 }
@@ -129,14 +276,24 @@ void memory_hierarchy_c::init(config_c& cfg) {
 /**
  * This creates a new memory request for the given memory address and accesses the top-level
  * memory components in the memory hierarchy (e.g., L1 or main memory). 
+ *
+ * Independent programs (multiprogram = 1) do not share memory: the core id
+ * goes above the address bits, so equal addresses of two cores are
+ * different lines.
  */
 
-bool memory_hierarchy_c::access(addr_t address, int access_type) {
+bool memory_hierarchy_c::access(addr_t address, int access_type, int core_id) {
+
+  if (m_num_cores > 1 && m_config.is_multiprogram())
+    address |= (addr_t)core_id << ADDR_SPACE_SHIFT;
 
   // create a memory request
   mem_req_s* req = create_mem_req(address, access_type);
+  req->m_core_id = core_id;
 
+  req->m_in_flight_idx = m_in_flight_reqs.size();
   m_in_flight_reqs.push_back(req);
+  ++m_core_in_flight[core_id];
 
   ////////////////////////////////////////////////////////////////////
   // TODO: Write the code to implement this function
@@ -151,9 +308,9 @@ bool memory_hierarchy_c::access(addr_t address, int access_type) {
 
     case static_cast<int>(Hierarchy::MULTI_LEVEL):
       if (req->m_type == REQ_IFETCH)
-        return m_l1i_cache->access(req);
+        return m_l1i_caches[core_id]->access(req);
       else
-        return m_l1d_cache->access(req);
+        return m_l1d_caches[core_id]->access(req);
 
     default:
       assert(false && "Hierarchy not implemented");
@@ -163,13 +320,116 @@ bool memory_hierarchy_c::access(addr_t address, int access_type) {
   ////////////////////////////////////////////////////////////////////
 }
 
+/**
+ * Functional access for sampled simulation: update the tag stores of the
+ * caches the reference goes through right away, with no request or timing.
+ * Main memory keeps no state, so DRAM_ONLY has nothing to warm.
+ */
+void memory_hierarchy_c::warm(addr_t address, int access_type) {
+  switch (m_config.get_mem_hierarchy()) {
+    case static_cast<int>(Hierarchy::SINGLE_LEVEL):
+      m_l1u_cache->warm(address, access_type);
+      break;
+
+    case static_cast<int>(Hierarchy::MULTI_LEVEL):
+      if (access_type == REQ_IFETCH)
+        m_l1i_caches[0]->warm(address, access_type);
+      else
+        m_l1d_caches[0]->warm(address, access_type);
+      break;
+  }
+}
+
+/**
+ * Write the tag stores of every cache and the trace position to a checkpoint
+ * (see checkpoint_format.h).  Call when no request is in flight, e.g. after
+ * warming the caches functionally.
+ */
+bool memory_hierarchy_c::save_checkpoint(const std::string& fname, const checkpoint_s& ckpt) {
+  const std::vector<cache_c*>& caches = get_caches();
+
+  checkpoint_format::header_s header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, checkpoint_format::MAGIC, sizeof(header.magic));
+  header.version       = checkpoint_format::VERSION;
+  header.num_caches    = caches.size();
+  header.num_insts     = ckpt.m_num_insts;
+  header.num_mem_insts = ckpt.m_num_mem_insts;
+  header.trace_offset  = ckpt.m_trace_pos.m_offset;
+  memcpy(header.trace_prev_addr, ckpt.m_trace_pos.m_prev_addr, sizeof(header.trace_prev_addr));
+
+  FILE* file = fopen(fname.c_str(), "wb");
+  if (!file) {
+    fprintf(stderr, "[Error]: cannot create checkpoint %s\n", fname.c_str());
+    return false;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (cache_c* cache : caches) ok = ok && cache->save_state(file);
+  if (fclose(file) != 0) ok = false;
+  if (!ok) fprintf(stderr, "[Error]: cannot write checkpoint %s\n", fname.c_str());
+  return ok;
+}
+
+/**
+ * Restore the tag stores from a checkpoint written by save_checkpoint() for
+ * the same hierarchy, and return where it was taken.  The file is mapped and
+ * each tag store is copied out of the mapping in one piece.
+ */
+bool memory_hierarchy_c::load_checkpoint(const std::string& fname, checkpoint_s* ckpt) {
+  int fd = ::open(fname.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(checkpoint_format::header_s)) {
+    fprintf(stderr, "[Error]: cannot read checkpoint %s\n", fname.c_str());
+    if (fd >= 0) ::close(fd);
+    return false;
+  }
+
+  void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "[Error]: cannot map checkpoint %s\n", fname.c_str());
+    return false;
+  }
+
+  const char* data = static_cast<const char*>(map);
+  size_t      size = st.st_size;
+  const std::vector<cache_c*>& caches = get_caches();
+
+  checkpoint_format::header_s header;
+  memcpy(&header, data, sizeof(header));
+  bool ok = memcmp(header.magic, checkpoint_format::MAGIC, sizeof(header.magic)) == 0 &&
+            header.version == checkpoint_format::VERSION && header.num_caches == caches.size();
+  data += sizeof(header);
+  size -= sizeof(header);
+
+  for (size_t ii = 0; ok && ii < caches.size(); ++ii) {
+    size_t used = caches[ii]->load_state(data, size);
+    ok = (used != 0);
+    data += used;
+    size -= used;
+  }
+  munmap(map, st.st_size);
+
+  if (!ok) {
+    fprintf(stderr, "[Error]: checkpoint %s does not match this memory hierarchy\n", fname.c_str());
+    return false;
+  }
+
+  ckpt->m_num_insts     = header.num_insts;
+  ckpt->m_num_mem_insts = header.num_mem_insts;
+  ckpt->m_trace_pos.m_offset = header.trace_offset;
+  memcpy(ckpt->m_trace_pos.m_prev_addr, header.trace_prev_addr, sizeof(header.trace_prev_addr));
+  return true;
+}
+
 /**
  * Create a new memory request that goes through memory hierarchy.  
  * @note You do not have to modify this (other than for debugging purposes).
  */
 mem_req_s* memory_hierarchy_c::create_mem_req(addr_t address, int access_type) { 
   
-  mem_req_s* req = new mem_req_s(address, access_type);
+  mem_req_s* req = m_req_pool.alloc(address, access_type);
 
   req->m_id = m_mem_req_id++;
   req->m_in_cycle = m_cycle;
@@ -186,9 +446,14 @@ mem_req_s* memory_hierarchy_c::create_mem_req(addr_t address, int access_type) {
  */
 void memory_hierarchy_c::free_mem_req(mem_req_s* req) {
 
-  auto& vv = m_in_flight_reqs;
-  vv.erase(std::remove(vv.begin(), vv.end(), req), vv.end());
-  delete req;
+  // the in-flight list is unordered: move the last request into the hole
+  mem_req_s* last = m_in_flight_reqs.back();
+  last->m_in_flight_idx = req->m_in_flight_idx;
+  m_in_flight_reqs[req->m_in_flight_idx] = last;
+  m_in_flight_reqs.pop_back();
+  --m_core_in_flight[req->m_core_id];
+
+  m_req_pool.free(req);
 
 #ifdef __DEBUG__
   //dump(false); // print out cache dump
@@ -211,9 +476,14 @@ void memory_hierarchy_c::run_a_cycle() {
   if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::SINGLE_LEVEL)) {
     if (m_l1u_cache) m_l1u_cache->run_a_cycle();
   } else if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::MULTI_LEVEL)) {
-    if (m_l2_cache)  m_l2_cache->run_a_cycle();
-    if (m_l1i_cache) m_l1i_cache->run_a_cycle();
-    if (m_l1d_cache) m_l1d_cache->run_a_cycle();
+    m_l2_cache->run_a_cycle();
+    // the cores take turns going first, so none always wins the shared L2
+    // among requests that reach it in the same cycle
+    for (int ii = 0; ii < m_num_cores; ++ii) {
+      const int core = (m_cycle + ii) % m_num_cores;
+      m_l1i_caches[core]->run_a_cycle();
+      m_l1d_caches[core]->run_a_cycle();
+    }
   }
 
   process_done_req();
@@ -221,6 +491,38 @@ void memory_hierarchy_c::run_a_cycle() {
   ++m_cycle;
 }
 
+/**
+ * Earliest cycle at which run_a_cycle() would do anything other than advance
+ * the clocks: the earliest pending event over main memory, the caches, and
+ * the done queue.  Requests that are already ready return the current cycle.
+ */
+counter memory_hierarchy_c::get_next_event_cycle() {
+  counter next = std::min(m_dram->get_next_event_cycle(),
+                          m_done_queue->get_earliest_rdy_cycle());
+
+  for (cache_c* cache : get_caches())
+    next = std::min(next, cache->get_next_event_cycle());
+  return next;
+}
+
+/**
+ * Jump every component clock straight to the next pending event.  Only call
+ * this when nothing new enters the hierarchy in the skipped cycles (i.e., the
+ * core is stalled), so the skipped ticks would have been no-ops.
+ */
+counter memory_hierarchy_c::skip_idle_cycles() {
+  counter next = get_next_event_cycle();
+  if (next == MAX_CYCLE || next <= m_cycle) return 0;
+
+  counter num_cycles = next - m_cycle;
+  m_dram->skip_cycles(num_cycles);
+  for (cache_c* cache : get_caches())
+    cache->skip_cycles(num_cycles);
+  m_cycle = next;
+
+  return num_cycles;
+}
+
 /**
  * This function processes the done request. The done_queue contains the
  * requests whose data is ready to return to the core.  Processing a "done
@@ -231,13 +533,11 @@ void memory_hierarchy_c::process_done_req() {
   // TODO: Write the code to implement this function
   // Free done requests
 
-  for (auto it = m_done_queue->m_entry.begin(); it != m_done_queue->m_entry.end(); /**/) {
-    mem_req_s* req = *it;
-    if (req->m_rdy_cycle > m_cycle) { ++it; continue; }
+  while (mem_req_s* req = m_done_queue->peek_ready(m_cycle)) {
+    m_done_queue->pop();
 
     req->m_done_cycle = m_cycle;
     free_mem_req(req);
-    it = m_done_queue->m_entry.erase(it);
   }
 
   ////////////////////////////////////////////////////////////////////
@@ -263,20 +563,20 @@ bool memory_hierarchy_c::is_wb_done() {
   // If there is no in-flight writeback requests for all the caches and
   // main memory, return true.
 
-  bool dram_ok = m_dram->m_in_flight_wb_queue->empty();
+  bool dram_ok = m_dram->is_wb_done();
 
   if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::DRAM_ONLY))
     return dram_ok;
 
   if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::SINGLE_LEVEL)) {
-    bool l1_ok = m_l1u_cache->m_in_flight_wb_queue->empty();
+    bool l1_ok = m_l1u_cache->is_wb_done();
     return dram_ok && l1_ok;
   }
 
-  bool l1i_ok = m_l1i_cache->m_in_flight_wb_queue->empty();
-  bool l1d_ok = m_l1d_cache->m_in_flight_wb_queue->empty();
-  bool l2_ok  = m_l2_cache->m_in_flight_wb_queue->empty();
-  return dram_ok && l1i_ok && l1d_ok && l2_ok;
+  bool caches_ok = true;
+  for (cache_c* cache : get_caches())
+    caches_ok = caches_ok && cache->is_wb_done();
+  return dram_ok && caches_ok;
   
   ////////////////////////////////////////////////////////////////////
 
@@ -284,26 +584,32 @@ bool memory_hierarchy_c::is_wb_done() {
 
 ///////////////////////////////////////////////////////////////////////////////////////////////
 memory_hierarchy_c::~memory_hierarchy_c() {
-  if (m_l1i_cache) delete m_l1i_cache;
-  if (m_l1d_cache) delete m_l1d_cache;
-  if (m_l2_cache)  delete m_l2_cache;
+  for (cache_c* cache : get_caches())
+    delete cache;
+  if (m_directory) delete m_directory;
   if (m_dram)      delete m_dram;
+  delete m_done_queue;
 }
 
 void memory_hierarchy_c::print_stats() {
 
   if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::SINGLE_LEVEL)) {
     m_l1u_cache->print_stats();
+    m_l1u_cache->print_ext_stats();
   } else if (m_config.get_mem_hierarchy() == static_cast<int>(Hierarchy::MULTI_LEVEL)) {
-    m_l1i_cache->print_stats();
-    m_l1d_cache->print_stats();
-    m_l2_cache->print_stats();
+    for (cache_c* cache : get_caches()) {
+      cache->print_stats();
+      cache->print_ext_stats();
+    }
   }
+  if (m_directory) m_directory->print_stats();
+  m_dram->print_stats();
+
+  // everything has drained by now, so any request still out is a leak
+  m_req_pool.report_leaks();
 }
 
 void memory_hierarchy_c::dump(bool is_file) {
-  if (m_l1u_cache) m_l1u_cache->dump_tag_store(is_file);
-  if (m_l1i_cache) m_l1i_cache->dump_tag_store(is_file);
-  if (m_l1d_cache) m_l1d_cache->dump_tag_store(is_file);
-  if (m_l2_cache)  m_l2_cache->dump_tag_store(is_file);
+  for (cache_c* cache : get_caches())
+    cache->dump_tag_store(is_file);
 }
@@ -5,10 +5,15 @@
 #define __MEMORY_HIERARCHY_H__
 
 #include "atom/mem_req.h"
-#include "memory_controller/simple_mem.h"
+#include "atom/mem_req_pool.h"
+#include "atom/ready_queue.h"
+#include "memory_controller/main_memory.h"
 #include "cache.h"
+#include "directory.h"
 #include "config.h"
+#include "cache_base/trace_reader.h"
 
+#include <string>
 #include <vector>
 
 enum class Hierarchy {
@@ -17,18 +22,28 @@ enum class Hierarchy {
   MULTI_LEVEL
 };
 
+/// where a checkpoint was taken (see memory_hierarchy_c::save_checkpoint)
+struct checkpoint_s {
+  trace_pos_s m_trace_pos;                     ///< next trace record to simulate
+  counter     m_num_insts;                     ///< instructions before the checkpoint
+  counter     m_num_mem_insts;                 ///< memory instructions before the checkpoint
+};
+
 // forward declaration
 class cache_c;
-class simple_mem_c;
+class main_memory_c;
 
 class memory_hierarchy_c {
 public:
-  memory_hierarchy_c(config_c& config);       
+  memory_hierarchy_c(config_c& config, int num_cores = 1);
   ~memory_hierarchy_c();         
 
   void init(config_c& config);                 ///< initialize memory hierarchy
-  bool access(addr_t addr, int access_type);   ///< access function
+  bool access(addr_t addr, int access_type, int core_id = 0);   ///< access function
+  void warm(addr_t addr, int access_type);     ///< functional access: tag stores only, no timing
   void run_a_cycle();                          ///< tick a cycle
+  counter get_next_event_cycle();              ///< earliest cycle any component has work (MAX_CYCLE: idle)
+  counter skip_idle_cycles();                  ///< fast-forward to the next event; returns # cycles skipped
 
   config_c m_config;
                                                
@@ -37,8 +52,11 @@ private:
   void free_mem_req(mem_req_s* req);
 
   counter m_mem_req_id;                        ///< memory request id to assign
-  simple_mem_c* m_dram;                        ///< simple main memory
+  main_memory_c* m_dram;                       ///< main memory (simple or banked DRAM)
   counter m_cycle;                             ///< clock cycle
+  int m_num_cores;                             ///< cores with private L1s (MULTI_LEVEL only if > 1)
+  static const int ADDR_SPACE_SHIFT = 48;      ///< multiprogram: core id bits above the trace addresses
+  mem_req_pool_c m_req_pool;                   ///< every request in the hierarchy comes from here
                                                
 public:
   void dump(bool is_file);                     ///< dump the data in cache after simulation
@@ -48,16 +66,25 @@ public:
   bool is_wb_done();
   void print_stats();
   int  get_num_in_flight_reqs(void) { return m_in_flight_reqs.size(); }
+  int  get_num_in_flight_reqs(int core_id) { return m_core_in_flight[core_id]; }
+  int  get_num_cores() const { return m_num_cores; }
+  const std::vector<cache_c*>& get_caches() const { return m_caches; }  ///< top level first
+
+  bool save_checkpoint(const std::string& fname, const checkpoint_s& ckpt);  ///< tag stores + "ckpt"
+  bool load_checkpoint(const std::string& fname, checkpoint_s* ckpt);        ///< false on any mismatch
                                               
 private:
   cache_c* m_l1u_cache;                        ///< l1u_cache for unified I/D
-  cache_c* m_l1i_cache;                        ///< l1i_cache
-  cache_c* m_l1d_cache;                        ///< l1d_cache 
+  std::vector<cache_c*> m_l1i_caches;          ///< l1i_cache of each core
+  std::vector<cache_c*> m_l1d_caches;          ///< l1d_cache of each core
 
-  cache_c* m_l2_cache;                         ///< l2_cache
+  cache_c* m_l2_cache;                         ///< l2_cache (shared by the cores)
+  std::vector<cache_c*> m_caches;              ///< every cache above, top level first (built by init)
+  directory_c* m_directory;                    ///< MESI directory (more than one core only)
                                                
-  std::vector<mem_req_s*> m_in_flight_reqs;    ///< memory requests in the memory hierarchy
-  queue_c* m_done_queue;                       ///< holds the requests that are done (i.e., data ready for the core)
+  std::vector<mem_req_s*> m_in_flight_reqs;    ///< memory requests in the memory hierarchy (unordered)
+  std::vector<int> m_core_in_flight;           ///< in-flight requests of each core
+  ready_queue_c* m_done_queue;                 ///< holds the requests that are done (i.e., data ready for the core)
 };
 
 #endif // !__MEMORY_HIERARCHY_H__
@@ -0,0 +1,85 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __MSHR_H__
+#define __MSHR_H__
+
+#include "atom/global.h"
+#include "atom/mem_req.h"
+
+#include <vector>
+
+/**
+ * One miss status holding register: an outstanding miss to a cache line and
+ * the requests waiting for it.  The primary request is the one that went to
+ * the next level; the others are secondary misses merged onto it.
+ */
+struct mshr_entry_s {
+  bool       m_valid;
+  addr_t     m_line_addr;                  ///< line address being fetched
+  mem_req_s* m_primary;                    ///< request sent to the next level
+  std::vector<mem_req_s*> m_targets;       ///< merged secondary misses (arrival order)
+};
+
+/***
+ *
+ * @class miss status holding register table (mshr_c)
+ *
+ * A fixed number of entries searched associatively by line address, each
+ * holding up to a fixed number of requests (the primary included).  With no
+ * entries the table is disabled and the cache sends every miss down.
+ */
+class mshr_c {
+public:
+  mshr_c() : m_num_targets(0), m_num_used(0) {}
+
+  /// num_targets counts the primary; 0 means no limit on merged requests
+  void init(int num_entries, int num_targets) {
+    m_entry.assign(num_entries, mshr_entry_s());
+    for (mshr_entry_s& entry : m_entry) entry.m_valid = false;
+    m_num_targets = num_targets;
+    m_num_used = 0;
+  }
+
+  bool is_enabled() const { return !m_entry.empty(); }
+  bool full() const { return m_num_used == (int)m_entry.size(); }
+  int  size() const { return m_num_used; }
+
+  /// entry for an outstanding miss to "line_addr" (nullptr if none)
+  mshr_entry_s* find(addr_t line_addr) {
+    for (mshr_entry_s& entry : m_entry)
+      if (entry.m_valid && entry.m_line_addr == line_addr) return &entry;
+    return nullptr;
+  }
+
+  /// true if another secondary miss fits in the entry
+  bool can_merge(const mshr_entry_s* entry) const {
+    return !m_num_targets || (int)entry->m_targets.size() + 1 < m_num_targets;
+  }
+
+  /// track a new primary miss; the table must not be full
+  mshr_entry_s* alloc(addr_t line_addr, mem_req_s* primary) {
+    for (mshr_entry_s& entry : m_entry) {
+      if (entry.m_valid) continue;
+      entry.m_valid = true;
+      entry.m_line_addr = line_addr;
+      entry.m_primary = primary;
+      entry.m_targets.clear();
+      ++m_num_used;
+      return &entry;
+    }
+    return nullptr;
+  }
+
+  void release(mshr_entry_s* entry) {
+    entry->m_valid = false;
+    --m_num_used;
+  }
+
+private:
+  std::vector<mshr_entry_s> m_entry;   ///< MSHR entries
+  int m_num_targets;                   ///< requests per entry (0: no limit)
+  int m_num_used;                      ///< valid entries
+};
+
+#endif // !__MSHR_H__
@@ -0,0 +1,185 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "partition.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+const int partition_c::NUM_UMON_SETS;
+
+static const char* partition_names[PART_LAST] = {"none", "static", "ucp"};
+
+int parse_partition(const std::string& name) {
+  for (int ii = 0; ii < PART_LAST; ++ii) {
+    if (name == partition_names[ii]) return ii;
+  }
+  return -1;
+}
+
+const char* partition_name(int type) {
+  return (type >= 0 && type < PART_LAST) ? partition_names[type] : "unknown";
+}
+
+partition_c::partition_c() {
+  m_type = PART_NONE;
+  m_num_cores = 0;
+  m_assoc = 0;
+  m_line_shift = 0;
+  m_set_mask = 0;
+  m_umon_stride = 1;
+  m_interval = 0;
+  m_next_update = 0;
+  m_num_repartitions = 0;
+  m_num_decisions = 0;
+}
+
+/**
+ * Both static and UCP partitioning start from their allocation right away;
+ * UCP starts from an equal split.  Bad settings stop the simulation.
+ */
+void partition_c::init(int type, int num_cores, int num_sets, int assoc, int line_size,
+                       const std::string& ways, counter interval) {
+  m_type = type;
+  m_num_cores = num_cores;
+  m_assoc = assoc;
+  m_line_shift = 0;
+  while ((1 << m_line_shift) < line_size) ++m_line_shift;
+  m_set_mask = num_sets - 1;
+  m_interval = (interval < 1) ? 1 : interval;
+  m_next_update = m_interval;
+  m_num_repartitions = 0;
+  m_num_decisions = 0;
+  if (m_type == PART_NONE) return;
+
+  if (assoc > 64) {
+    fprintf(stderr, "[Error]: way partitioning supports at most 64 ways\n");
+    exit(1);
+  }
+  if (assoc < num_cores) {
+    fprintf(stderr, "[Error]: way partitioning needs a way per core (%d ways, %d cores)\n",
+            assoc, num_cores);
+    exit(1);
+  }
+
+  // equal split, the first cores get the leftover ways
+  std::vector<int> alloc(num_cores, assoc / num_cores);
+  for (int ii = 0; ii < assoc % num_cores; ++ii) ++alloc[ii];
+
+  if (m_type == PART_STATIC && ways != "none") {
+    alloc.clear();
+    std::stringstream ss(ways);
+    std::string item;
+    int total = 0;
+    while (std::getline(ss, item, ',')) {
+      alloc.push_back(atoi(item.c_str()));
+      total += alloc.back();
+      if (alloc.back() < 1) total = assoc + 1;
+    }
+    if ((int)alloc.size() != num_cores || total > assoc) {
+      fprintf(stderr, "[Error]: l2_partition_ways %s does not give each of %d cores at least "
+              "one of %d ways\n", ways.c_str(), num_cores, assoc);
+      exit(1);
+    }
+  }
+  set_allocation(alloc);
+
+  if (m_type == PART_UCP) {
+    m_umon_stride = (num_sets > NUM_UMON_SETS) ? num_sets / NUM_UMON_SETS : 1;
+    const int num_umon_sets = num_sets / m_umon_stride;
+    m_shadow_tags.assign(num_cores, std::vector<addr_t>(num_umon_sets * assoc, 0));
+    m_umon_hits.assign(num_cores, std::vector<counter>(assoc, 0));
+  }
+}
+
+/**
+ * Move the line to the MRU position of the core's shadow stack, counting a
+ * hit at the position it was found.
+ */
+void partition_c::on_access(addr_t addr, int core) {
+  if (m_type != PART_UCP) return;
+
+  const addr_t line = addr >> m_line_shift;
+  const int set = line & m_set_mask;
+  if (set % m_umon_stride) return;
+
+  addr_t* stack = &m_shadow_tags[core][(set / m_umon_stride) * m_assoc];
+  int pos = 0;
+  while (pos < m_assoc - 1 && stack[pos] != line + 1) ++pos;
+  if (stack[pos] == line + 1) ++m_umon_hits[core][pos];
+
+  for (; pos > 0; --pos) stack[pos] = stack[pos - 1];
+  stack[0] = line + 1;
+}
+
+/**
+ * Checked on every demand lookup, so the decisions fall on the same lookups
+ * whether or not idle cycles are skipped.  Returns true when the ways moved.
+ */
+bool partition_c::update(counter cycle) {
+  if (m_type != PART_UCP || cycle < m_next_update) return false;
+  while (m_next_update <= cycle) m_next_update += m_interval;
+
+  std::vector<int> alloc = lookahead();
+  ++m_num_decisions;
+  for (std::vector<counter>& hits : m_umon_hits) {
+    for (counter& count : hits) count /= 2;
+  }
+
+  if (alloc == m_ways) return false;
+  set_allocation(alloc);
+  ++m_num_repartitions;
+  return true;
+}
+
+/**
+ * Lookahead allocation: every core starts with one way; while ways are
+ * left, the core whose next k ways (for its best k) add the most hits per
+ * way gets those k ways.  Ties go to the lower core.
+ */
+std::vector<int> partition_c::lookahead() const {
+  std::vector<int> alloc(m_num_cores, 1);
+  int balance = m_assoc - m_num_cores;
+
+  while (balance > 0) {
+    int     best_core = -1, best_k = 0;
+    counter best_hits = 0;
+    for (int core = 0; core < m_num_cores; ++core) {
+      counter hits = 0;
+      for (int k = 1; k <= balance && alloc[core] + k <= m_assoc; ++k) {
+        hits += m_umon_hits[core][alloc[core] + k - 1];
+        // hits / k > best_hits / best_k
+        if (best_core < 0 || hits * best_k > best_hits * k) {
+          best_core = core;
+          best_k = k;
+          best_hits = hits;
+        }
+      }
+    }
+    alloc[best_core] += best_k;
+    balance -= best_k;
+  }
+  return alloc;
+}
+
+void partition_c::set_allocation(const std::vector<int>& ways) {
+  m_ways = ways;
+  m_masks.assign(m_num_cores, 0);
+  int first = 0;
+  for (int core = 0; core < m_num_cores; ++core) {
+    for (int way = first; way < first + ways[core]; ++way) m_masks[core] |= 1ULL << way;
+    first += ways[core];
+  }
+}
+
+void partition_c::print_stats() {
+  std::cout << "partitioning: " << partition_name(m_type) << "\n";
+  for (int core = 0; core < m_num_cores; ++core)
+    std::cout << "ways of core " << core << ": " << m_ways[core] << "\n";
+  if (m_type == PART_UCP) {
+    std::cout << "number of partitioning decisions: " << m_num_decisions << "\n";
+    std::cout << "number of repartitions: " << m_num_repartitions << "\n";
+  }
+}
@@ -0,0 +1,85 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __PARTITION_H__
+#define __PARTITION_H__
+
+#include "atom/global.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Ways of a shared cache the cores may fill (see partition_c)
+ */
+enum partition_e {
+  PART_NONE = 0,      ///< every core fills any way (default)
+  PART_STATIC,        ///< fixed number of ways per core
+  PART_UCP,           ///< utility-based: ways follow the shadow-tag hit curves
+  PART_LAST
+};
+
+int         parse_partition(const std::string& name);  ///< partitioning for a config name, -1 if unknown
+const char* partition_name(int type);
+
+/***
+ *
+ * @class cache partitioner (partition_c)
+ *
+ * Way partitioning of a cache shared by several cores.  Each core gets a
+ * contiguous range of ways (at least one) that its misses, fills and
+ * write-backs may replace, given to the cache as one way mask per core;
+ * lookups still search every way.
+ *
+ * Static partitioning uses a fixed number of ways per core.  UCP
+ * (utility-based cache partitioning) keeps a utility monitor (UMON) per
+ * core: LRU shadow tags of the full associativity for NUM_UMON_SETS sampled
+ * sets, which count the hits the core would get at each stack position if
+ * it had the cache to itself.  Every "interval" cycles the lookahead
+ * algorithm hands out the ways by marginal utility (hits per extra way) and
+ * the counters are halved, so the allocation follows phase changes.
+ */
+class partition_c {
+public:
+  static const int NUM_UMON_SETS = 32;        ///< sampled sets per utility monitor
+
+  partition_c();
+
+  /// "ways": comma-separated ways per core for PART_STATIC ("none": an equal split)
+  void init(int type, int num_cores, int num_sets, int assoc, int line_size,
+            const std::string& ways, counter interval);
+
+  bool is_enabled() const { return m_type != PART_NONE; }
+  void on_access(addr_t addr, int core);      ///< demand lookup of "core" (trains the UMONs)
+  bool update(counter cycle);                 ///< UCP: repartition when the interval is over
+  const std::vector<uint64_t>& get_masks() const { return m_masks; }
+
+  void print_stats();
+
+private:
+  void set_allocation(const std::vector<int>& ways);  ///< contiguous ways, core 0 first
+  std::vector<int> lookahead() const;                 ///< UCP allocation from the hit counters
+
+  int m_type;
+  int m_num_cores;
+  int m_assoc;
+  int m_line_shift;
+  int m_set_mask;
+  int m_umon_stride;                          ///< every m_umon_stride-th set is sampled
+
+  counter m_interval;                         ///< cycles between UCP decisions
+  counter m_next_update;                      ///< cycle of the next UCP decision
+
+  std::vector<int> m_ways;                    ///< ways of each core
+  std::vector<uint64_t> m_masks;              ///< way mask of each core
+
+  // UMON: per core, NUM_UMON_SETS LRU stacks (MRU first, 0: empty) and the
+  // hits at each stack position
+  std::vector<std::vector<addr_t>> m_shadow_tags;
+  std::vector<std::vector<counter>> m_umon_hits;
+
+  counter m_num_repartitions;                 ///< UCP decisions that changed the allocation
+  counter m_num_decisions;                    ///< UCP decisions
+};
+
+#endif // !__PARTITION_H__
@@ -0,0 +1,278 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#include "prefetcher.h"
+
+#include <cstdlib>
+#include <iostream>
+
+const int prefetcher_c::MAX_LEVEL;
+
+static const char* prefetcher_names[PREF_LAST] = {"none", "next_line", "stride", "stream"};
+
+int parse_prefetcher(const std::string& name) {
+  for (int ii = 0; ii < PREF_LAST; ++ii) {
+    if (name == prefetcher_names[ii]) return ii;
+  }
+  return -1;
+}
+
+const char* prefetcher_name(int type) {
+  return (type >= 0 && type < PREF_LAST) ? prefetcher_names[type] : "unknown";
+}
+
+static int log2_int(int v) {
+  int shift = 0;
+  while (v > 1) { v >>= 1; ++shift; }
+  return shift;
+}
+
+prefetcher_c::prefetcher_c() {
+  init(PREF_NONE, 1, 1, false, 64, 1);
+}
+
+/**
+ * "num_lines" (the cache capacity in lines) sizes the filter of lines evicted
+ * by prefetch fills that the pollution count looks up.
+ */
+void prefetcher_c::init(int type, int degree, int distance, bool throttle, int line_size,
+                        int num_lines) {
+  m_type = type;
+  m_degree = (degree < 1) ? 1 : degree;
+  m_distance = (distance < 1) ? 1 : distance;
+  m_throttle = throttle;
+  m_line_shift = log2_int(line_size);
+  m_level = MAX_LEVEL;
+
+  m_stride_table.assign(NUM_STRIDE_ENTRIES, stride_entry_s());
+  for (stride_entry_s& entry : m_stride_table) entry.m_region = 0;
+  m_streams.assign(NUM_STREAMS, stream_s());
+  for (stream_s& stream : m_streams) stream.m_valid = false;
+  m_stream_clock = 0;
+
+  m_in_flight.clear();
+  m_unused.clear();
+  m_victims.assign((num_lines < 1) ? 1 : num_lines, 0);
+
+  m_num_issued = m_int_issued = 0;
+  m_num_useful = m_int_useful = 0;
+  m_num_late = m_int_late = 0;
+  m_num_useless = 0;
+  m_num_pollution = m_int_pollution = 0;
+  m_num_demand_misses = m_int_demand_misses = 0;
+  m_num_throttle_up = m_num_throttle_down = 0;
+}
+
+/// the configured value scaled by the aggressiveness level (at least 1)
+int prefetcher_c::get_degree() const {
+  return (m_degree * m_level + MAX_LEVEL - 1) / MAX_LEVEL;
+}
+
+int prefetcher_c::get_distance() const {
+  return (m_distance * m_level + MAX_LEVEL - 1) / MAX_LEVEL;
+}
+
+void prefetcher_c::on_demand(addr_t addr, bool hit, std::vector<addr_t>* lines) {
+  const addr_t line = addr >> m_line_shift;
+  bool pf_hit = false;
+
+  if (hit) {
+    if (m_unused.erase(line)) {
+      pf_hit = true;
+      ++m_num_useful;
+      ++m_int_useful;
+    }
+  } else {
+    ++m_num_demand_misses;
+    ++m_int_demand_misses;
+    if (m_in_flight.count(line)) {
+      ++m_num_late;
+      ++m_int_late;
+    }
+    addr_t& victim = m_victims[line % m_victims.size()];
+    if (victim == line + 1) {
+      ++m_num_pollution;
+      ++m_int_pollution;
+      victim = 0;
+    }
+    m_unused.erase(line);     // lost to a back-invalidation
+  }
+
+  const size_t first = lines->size();
+  switch (m_type) {
+    case PREF_NEXT_LINE: train_next_line(line, hit, pf_hit, lines); break;
+    case PREF_STRIDE:    train_stride(line, lines); break;
+    case PREF_STREAM:    train_stream(line, hit, pf_hit, lines); break;
+  }
+  for (size_t ii = first; ii < lines->size(); ++ii) (*lines)[ii] <<= m_line_shift;
+}
+
+void prefetcher_c::on_issue(addr_t line) {
+  m_in_flight.insert(line);
+  ++m_num_issued;
+  if (++m_int_issued == (counter)THROTTLE_INTERVAL && m_throttle) throttle();
+}
+
+void prefetcher_c::on_fill(addr_t line, bool was_present) {
+  m_in_flight.erase(line);
+  if (!was_present) m_unused.insert(line);
+
+  addr_t& victim = m_victims[line % m_victims.size()];
+  if (victim == line + 1) victim = 0;
+}
+
+void prefetcher_c::on_evict(addr_t line, bool by_prefetch) {
+  if (m_unused.erase(line)) ++m_num_useless;
+  if (by_prefetch) m_victims[line % m_victims.size()] = line + 1;
+}
+
+/**
+ * Move the aggressiveness down when the interval's prefetches were mostly
+ * wrong or polluted the cache, and up when they were accurate but late.
+ */
+void prefetcher_c::throttle() {
+  const double accuracy  = (double)(m_int_useful + m_int_late) / m_int_issued;
+  const double lateness  = (m_int_useful + m_int_late) ?
+                           (double)m_int_late / (m_int_useful + m_int_late) : 0.0;
+  const double pollution = m_int_demand_misses ?
+                           (double)m_int_pollution / m_int_demand_misses : 0.0;
+
+  if (accuracy < 0.40 || (accuracy < 0.75 && pollution > 0.05)) {
+    if (m_level > 1) {
+      --m_level;
+      ++m_num_throttle_down;
+    }
+  } else if (lateness > 0.10 && m_level < MAX_LEVEL) {
+    ++m_level;
+    ++m_num_throttle_up;
+  }
+
+  m_int_issued = m_int_useful = m_int_late = m_int_pollution = m_int_demand_misses = 0;
+}
+
+/**
+ * Tagged next-line: a miss or the first hit on a prefetched line fetches the
+ * "degree" lines starting "distance" lines ahead.
+ */
+void prefetcher_c::train_next_line(addr_t line, bool hit, bool pf_hit, std::vector<addr_t>* lines) {
+  if (hit && !pf_hit) return;
+  const int distance = get_distance();
+  for (int ii = 0; ii < get_degree(); ++ii) lines->push_back(line + distance + ii);
+}
+
+/**
+ * Without the PC, references are grouped by 4KB region: a region's entry
+ * learns the stride between its consecutive references and, once the same
+ * stride is seen twice in a row, fetches "degree" strides starting
+ * "distance" strides ahead.
+ */
+void prefetcher_c::train_stride(addr_t line, std::vector<addr_t>* lines) {
+  const addr_t region = line >> (REGION_SHIFT - m_line_shift);
+  stride_entry_s& entry = m_stride_table[region % NUM_STRIDE_ENTRIES];
+  if (entry.m_region != region + 1) {
+    entry.m_region = region + 1;
+    entry.m_last_line = line;
+    entry.m_stride = 0;
+    entry.m_conf = 0;
+    return;
+  }
+
+  const int64_t delta = (int64_t)(line - entry.m_last_line);
+  if (delta == 0) return;
+  entry.m_last_line = line;
+
+  if (delta == entry.m_stride) {
+    if (entry.m_conf < 3) ++entry.m_conf;
+  } else {
+    if (entry.m_conf > 0) --entry.m_conf;
+    if (entry.m_conf == 0) entry.m_stride = delta;
+  }
+  if (entry.m_conf < 2) return;
+
+  const int distance = get_distance();
+  for (int ii = 0; ii < get_degree(); ++ii) {
+    const int64_t target = (int64_t)line + entry.m_stride * (distance + ii);
+    if (target >= 0) lines->push_back(target);
+  }
+}
+
+/**
+ * A miss near the last miss of a tracked stream trains it in that direction;
+ * two in a row confirm it.  A confirmed stream then keeps the lines from
+ * "distance" ahead of each trigger (miss or first hit on a prefetched line)
+ * to "distance + degree - 1" ahead fetched, at most "degree" new ones per
+ * trigger.  A miss no stream claims starts a new one in the LRU slot.
+ */
+void prefetcher_c::train_stream(addr_t line, bool hit, bool pf_hit, std::vector<addr_t>* lines) {
+  if (hit && !pf_hit) return;
+
+  stream_s* stream = nullptr;
+  for (stream_s& ss : m_streams) {
+    if (!ss.m_valid) continue;
+    const int64_t delta = (int64_t)(line - ss.m_last_line);
+    if (delta >= -STREAM_WINDOW && delta <= STREAM_WINDOW) {
+      stream = &ss;
+      break;
+    }
+  }
+
+  if (!stream) {
+    if (hit) return;
+    stream = &m_streams[0];
+    for (stream_s& ss : m_streams) {
+      if (!ss.m_valid) { stream = &ss; break; }
+      if (ss.m_lru < stream->m_lru) stream = &ss;
+    }
+    stream->m_valid = true;
+    stream->m_last_line = line;
+    stream->m_dir = 0;
+    stream->m_conf = 0;
+    stream->m_next_pf = line;
+    stream->m_lru = ++m_stream_clock;
+    return;
+  }
+
+  const int64_t delta = (int64_t)(line - stream->m_last_line);
+  if (delta == 0) return;
+  const int dir = (delta > 0) ? 1 : -1;
+  if (dir == stream->m_dir) {
+    ++stream->m_conf;
+  } else {
+    stream->m_dir = dir;
+    stream->m_conf = 1;
+    stream->m_next_pf = line + dir;
+  }
+  stream->m_last_line = line;
+  stream->m_lru = ++m_stream_clock;
+  if (stream->m_conf < 2) return;
+
+  const int distance = get_distance();
+  const int degree = get_degree();
+  const int64_t start = (int64_t)line + dir * distance;
+  int64_t next = (int64_t)stream->m_next_pf;
+  if ((next - start) * dir < 0) next = start;
+  for (int ii = 0; ii < degree && (next - (int64_t)line) * dir < distance + degree && next >= 0; ++ii) {
+    lines->push_back(next);
+    next += dir;
+  }
+  stream->m_next_pf = next;
+}
+
+void prefetcher_c::print_stats() {
+  const counter used = m_num_useful + m_num_late;
+  std::cout << "prefetcher: " << prefetcher_name(m_type) << "\n";
+  std::cout << "number of prefetches: "             << m_num_issued << "\n";
+  std::cout << "number of useful prefetches: "      << m_num_useful << "\n";
+  std::cout << "number of late prefetches: "        << m_num_late << "\n";
+  std::cout << "number of useless prefetches: "     << m_num_useless << "\n";
+  std::cout << "number of prefetch pollution misses: " << m_num_pollution << "\n";
+  std::cout << "prefetch accuracy: "   << (m_num_issued ? (double)used / m_num_issued * 100 : 0.0) << " % \n";
+  std::cout << "prefetch coverage: "   << ((m_num_useful + m_num_demand_misses) ?
+                                           (double)m_num_useful / (m_num_useful + m_num_demand_misses) * 100 : 0.0)
+            << " % \n";
+  std::cout << "prefetch timeliness: " << (used ? (double)m_num_useful / used * 100 : 0.0) << " % \n";
+  if (m_throttle) {
+    std::cout << "prefetch throttle level: " << m_level << " of " << MAX_LEVEL
+              << " (" << m_num_throttle_up << " up, " << m_num_throttle_down << " down)\n";
+  }
+}
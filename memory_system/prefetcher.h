@@ -0,0 +1,121 @@
+// ECE 430.322: Computer Organization
+// Lab 4: Memory System Simulation
+
+#ifndef __PREFETCHER_H__
+#define __PREFETCHER_H__
+
+#include "atom/global.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Hardware prefetchers a cache can run (see prefetcher_c)
+ */
+enum prefetcher_e {
+  PREF_NONE = 0,      ///< no prefetching (default)
+  PREF_NEXT_LINE,     ///< the lines after a miss or a first hit on a prefetched line
+  PREF_STRIDE,        ///< constant stride within a 4KB region (no PC in the trace)
+  PREF_STREAM,        ///< ascending/descending streams confirmed by nearby misses
+  PREF_LAST
+};
+
+int         parse_prefetcher(const std::string& name);  ///< prefetcher for a config name, -1 if unknown
+const char* prefetcher_name(int type);
+
+/***
+ *
+ * @class prefetcher (prefetcher_c)
+ *
+ * The prediction and bookkeeping half of a cache's prefetcher.  The cache
+ * reports every demand lookup, and the prefetcher returns the lines to fetch:
+ * "degree" lines per trigger, starting "distance" lines (or strides) ahead.
+ * The cache issues them and reports back when each one is sent, filled and
+ * evicted, which gives the statistics:
+ *
+ *   accuracy   : (useful + late) / issued
+ *   coverage   : useful / (useful + demand misses)
+ *   timeliness : useful / (useful + late)
+ *   pollution  : demand misses to lines a prefetch fill evicted
+ *
+ * where a prefetch is useful if a demand hits its line before eviction and
+ * late if a demand misses while it is still in flight.  With throttling, the
+ * degree and distance are scaled by an aggressiveness level that is moved
+ * every THROTTLE_INTERVAL issued prefetches from the accuracy, lateness and
+ * pollution of the interval (feedback-directed prefetching).
+ */
+class prefetcher_c {
+public:
+  static const int MAX_LEVEL = 4;               ///< full degree and distance
+  static const int THROTTLE_INTERVAL = 256;     ///< issued prefetches per throttling decision
+  static const int NUM_STRIDE_ENTRIES = 64;     ///< stride table (direct mapped by region)
+  static const int NUM_STREAMS = 16;            ///< stream tracker (LRU)
+  static const int STREAM_WINDOW = 16;          ///< lines from its last miss a stream trains on
+  static const int REGION_SHIFT = 12;           ///< stride regions are 4KB
+
+  prefetcher_c();
+  void init(int type, int degree, int distance, bool throttle, int line_size, int num_lines);
+
+  bool is_enabled() const { return m_type != PREF_NONE; }
+
+  /// demand lookup of "addr"; appends the addresses of the lines to prefetch to "lines"
+  void on_demand(addr_t addr, bool hit, std::vector<addr_t>* lines);
+  // the rest take line addresses (address >> log2(line size))
+  void on_issue(addr_t line);                   ///< a prefetch of "line" was sent down
+  void on_fill(addr_t line, bool was_present);  ///< the prefetch of "line" came back
+  void on_evict(addr_t line, bool by_prefetch); ///< "line" left the cache
+  bool is_in_flight(addr_t line) const { return m_in_flight.count(line) != 0; }
+
+  void print_stats();
+
+private:
+  struct stride_entry_s {
+    addr_t  m_region;           ///< region number + 1 (0: invalid)
+    addr_t  m_last_line;
+    int64_t m_stride;           ///< in lines
+    int     m_conf;             ///< 2-bit confidence
+  };
+
+  struct stream_s {
+    bool    m_valid;
+    addr_t  m_last_line;        ///< last miss of the stream
+    int     m_dir;              ///< +1/-1 (0: direction not known yet)
+    int     m_conf;             ///< misses seen in "m_dir"
+    addr_t  m_next_pf;          ///< next line to prefetch once trained
+    counter m_lru;
+  };
+
+  void train_next_line(addr_t line, bool hit, bool pf_hit, std::vector<addr_t>* lines);
+  void train_stride(addr_t line, std::vector<addr_t>* lines);
+  void train_stream(addr_t line, bool hit, bool pf_hit, std::vector<addr_t>* lines);
+  void throttle();
+  int  get_degree() const;
+  int  get_distance() const;
+
+  int  m_type;
+  int  m_degree;
+  int  m_distance;
+  bool m_throttle;
+  int  m_line_shift;
+  int  m_level;                                  ///< aggressiveness, 1..MAX_LEVEL
+
+  std::vector<stride_entry_s> m_stride_table;
+  std::vector<stream_s>       m_streams;
+  counter                     m_stream_clock;
+
+  std::unordered_set<addr_t> m_in_flight;        ///< lines with a prefetch outstanding
+  std::unordered_set<addr_t> m_unused;           ///< prefetched lines no demand has hit yet
+  std::vector<addr_t>        m_victims;          ///< lines evicted by prefetch fills (direct mapped)
+
+  // statistics (whole run / current throttling interval)
+  counter m_num_issued, m_int_issued;
+  counter m_num_useful, m_int_useful;
+  counter m_num_late, m_int_late;
+  counter m_num_useless;
+  counter m_num_pollution, m_int_pollution;
+  counter m_num_demand_misses, m_int_demand_misses;
+  counter m_num_throttle_up, m_num_throttle_down;
+};
+
+#endif // !__PREFETCHER_H__